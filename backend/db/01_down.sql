@@ -1,3 +1,4 @@
 -- Drop tables in reverse order of creation to handle foreign keys
+DROP TABLE IF EXISTS translation_audio;
 DROP TABLE IF EXISTS translations;
 DROP TABLE IF EXISTS audio_files;
@@ -1,20 +1,30 @@
 -- Table for metadata / references
 CREATE TABLE translations (
-    id INT AUTO_INCREMENT PRIMARY KEY,
-    original_text VARCHAR(255) NOT NULL UNIQUE,  -- Make sure this is UNIQUE
+    text_hash BINARY(32) NOT NULL PRIMARY KEY,  -- SHA-256 of the canonical original_text
+    original_text TEXT NOT NULL,                -- No length cap, lookups go through text_hash
     english_meaning VARCHAR(512) NOT NULL,
     pinyin_mandarin VARCHAR(512) NOT NULL,
     jyutping_cantonese VARCHAR(512) NOT NULL,
     equivalent_cantonese VARCHAR(512) NOT NULL,
-    audio_file_id INT DEFAULT NULL,            -- Points to audio_files table
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-    INDEX (original_text)  -- For performance
+    created_at DATETIME DEFAULT CURRENT_TIMESTAMP
 );
 
 -- Table for audio blobs
 CREATE TABLE audio_files (
     id INT AUTO_INCREMENT PRIMARY KEY,
+    content_hash BINARY(32) NOT NULL,          -- SHA-256 of audio_data
     mime_type VARCHAR(100) NOT NULL,           -- e.g. "audio/mpeg" or "audio/wav"
     audio_data LONGBLOB NOT NULL,              -- Your actual BLOB data
-    created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+    created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+    UNIQUE KEY (content_hash, mime_type)       -- Identical clips of the same type are stored once
+);
+
+-- One clip per translation and voice (e.g. "mandarin", "cantonese")
+CREATE TABLE translation_audio (
+    text_hash BINARY(32) NOT NULL,
+    voice VARCHAR(32) NOT NULL,
+    audio_file_id INT NOT NULL,
+    PRIMARY KEY (text_hash, voice),
+    FOREIGN KEY (text_hash) REFERENCES translations(text_hash) ON DELETE CASCADE,
+    FOREIGN KEY (audio_file_id) REFERENCES audio_files(id)
 );
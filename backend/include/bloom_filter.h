@@ -0,0 +1,68 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Thread-safe Bloom filter over already-hashed keys.
+ *
+ * Keys are expected to be uniformly distributed digests (e.g. the SHA-256
+ * text hashes from Database::textHash), so bit positions are derived directly
+ * from the key bytes with double hashing instead of rehashing. A negative
+ * answer is definite; a positive one means "probably present".
+ *
+ * Bits are stored as atomic words, so add() and mightContain() may be called
+ * concurrently without a lock.
+ */
+class BloomFilter {
+public:
+    /**
+     * Create a filter sized for an expected number of keys.
+     *
+     * @param expectedItems Number of keys the filter should hold
+     * @param falsePositiveRate Target false-positive rate at that size
+     */
+    explicit BloomFilter(size_t expectedItems = 1 << 20, double falsePositiveRate = 0.01);
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+    void add(std::string_view key);
+    bool mightContain(std::string_view key) const;
+    void clear();
+
+    size_t bitCount() const { return m_bitCount; }
+    size_t hashCount() const { return m_hashCount; }
+    size_t itemCount() const { return m_itemCount.load(); }
+
+    /**
+     * Write the filter to disk so a restart can skip rebuilding it.
+     *
+     * @return true if the snapshot was written completely
+     */
+    bool saveSnapshot(const std::string& path) const;
+
+    /**
+     * Load a snapshot written by saveSnapshot().
+     *
+     * @return false if the file is missing, corrupt, or was written by a
+     *         filter with a different size
+     */
+    bool loadSnapshot(const std::string& path);
+
+private:
+    // Derive the two base hashes used for double hashing
+    static void baseHashes(std::string_view key, uint64_t& h1, uint64_t& h2);
+
+    size_t m_bitCount;
+    size_t m_hashCount;
+    size_t m_wordCount;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+    std::atomic<size_t> m_itemCount;
+};
+
+#endif // BLOOM_FILTER_H
@@ -2,11 +2,33 @@
 #define DATABASE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <map>
 #include <memory>
+#include <future>
+#include <optional>
+#include <mutex>
 // Use X DevAPI headers instead
 #include <mysqlx/xdevapi.h>
 #include <spdlog/spdlog.h>
+#include "bloom_filter.h"
+
+// A cached translation together with its audio clips, keyed by voice
+struct TranslationRecord {
+    std::string originalText;
+    std::string englishMeaning;
+    std::string pinyinMandarin;
+    std::string jyutpingCantonese;
+    std::string equivalentCantonese;
+    std::map<std::string, int> audioFileIds;  // voice -> audio_files.id
+};
+
+// A stored audio clip
+struct AudioRecord {
+    std::string mimeType;
+    std::string data;
+};
 
 class Database {
 public:
@@ -24,20 +46,48 @@ public:
                          const std::string& englishMeaning,
                          const std::string& pinyinMandarin,
                          const std::string& jyutpingCantonese,
-                         const std::string& equivalentCantonese,
-                         int audioFileId = -1);
-                         
-    bool getTranslation(const std::string& originalText,
-                       std::string& englishMeaning,
-                       std::string& pinyinMandarin,
-                       std::string& jyutpingCantonese,
-                       std::string& equivalentCantonese,
-                       int& audioFileId);
+                         const std::string& equivalentCantonese);
+    
+    // Link an audio clip to a translation for one voice (e.g. "mandarin", "cantonese")
+    bool storeTranslationAudio(const std::string& originalText,
+                              const std::string& voice,
+                              int audioFileId);
+    
+    // Fetch a translation and all of its audio IDs in a single joined query
+    bool getTranslation(const std::string& originalText, TranslationRecord& record);
+    
+    // SHA-256 of the canonical form of a text, as stored in translations.text_hash
+    static std::string textHash(const std::string& originalText);
+    
+    // Process-wide filter of stored text hashes. Once installed, getTranslation
+    // skips the database for texts that were never stored, and every
+    // successful storeTranslation adds its key. Pass nullptr to remove it.
+    static void setTranslationFilter(std::shared_ptr<BloomFilter> filter);
+    static std::shared_ptr<BloomFilter> translationFilter();
+    
+    // false only when the filter proves the text was never stored
+    static bool mightHaveTranslation(const std::string& originalText);
+    
+    // Stream every stored text hash into a filter; returns the count or -1
+    long long loadTranslationKeys(BloomFilter& filter);
     
     // Audio file operations
     int storeAudioFile(const std::string& mimeType, const std::string& audioFilePath);
+    // Store audio that is already in memory (e.g. a TTS response) without a temp file
+    int storeAudioData(const std::string& mimeType, std::string_view audioData);
     bool getAudioData(int audioFileId, std::string& mimeType, std::string& audioData);
     
+    // Non-blocking variants. Each call runs on a small pool of executor threads
+    // that hold their own sessions, so the caller never waits on MySQL I/O.
+    std::future<std::optional<TranslationRecord>> getTranslationAsync(std::string originalText);
+    std::future<bool> storeTranslationAsync(TranslationRecord record);
+    std::future<int> storeAudioDataAsync(std::string mimeType, std::string audioData);
+    std::future<std::optional<AudioRecord>> getAudioDataAsync(int audioFileId);
+    
+    // Number of executor threads (sessions) used by the async methods; takes
+    // effect if called before the first async call
+    void setAsyncPoolSize(size_t threads);
+    
     // Transaction methods for testing
     bool beginTransaction() {
         return executeQuery("START TRANSACTION");
@@ -52,6 +102,8 @@ public:
     }
 
 private:
+    class AsyncExecutor;
+    
     // Database connection properties
     std::unique_ptr<mysqlx::Session> session;
     
@@ -65,9 +117,18 @@ private:
     std::string database;
     int port;
     
+    // Executor for the async methods, started on first use
+    std::unique_ptr<AsyncExecutor> m_executor;
+    std::mutex m_executorMutex;
+    size_t m_asyncPoolSize;
+    
     // Helper methods
     void loadConfig();
     bool executeQuery(const std::string& query);
+    AsyncExecutor& executor();
+    
+    template <typename Result, typename Task>
+    std::future<Result> runAsync(Task task);
 };
 
 #endif // DATABASE_H 
\ No newline at end of file
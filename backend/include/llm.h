@@ -16,6 +16,8 @@ std::shared_ptr<spdlog::logger> getLLMLogger();
 #define LLM_LOG_WARNING(...) SPDLOG_LOGGER_WARN(getLLMLogger(), __VA_ARGS__)
 #define LLM_LOG_ERROR(...) SPDLOG_LOGGER_ERROR(getLLMLogger(), __VA_ARGS__)
 #define LLM_LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(getLLMLogger(), __VA_ARGS__)
+#define LLM_LOG_PAYLOAD(level, label, payload) \
+    HANSNAP_LOG_PAYLOAD(getLLMLogger(), ::hansnap::Logger::Level::level, label, payload)
 
 // Use the nlohmann json namespace
 using json = nlohmann::json;
@@ -50,6 +52,22 @@ std::string extractJSONContent(const std::string& rawResponse);
  */
 json addAudioToJson(const json& translationJson);
 
+/**
+ * Helper function to encode binary data as a base64 string
+ * 
+ * @param data The binary data
+ * @return The base64-encoded string (no line breaks)
+ */
+std::string base64_encode(const std::string& data);
+
+/**
+ * Helper function to decode base64 string to binary data
+ * 
+ * @param encoded The base64-encoded string
+ * @return The decoded binary data as a string
+ */
+std::string base64_decode(const std::string& encoded);
+
 /**
  * Get a structured response directly into a C++ struct or any type that can be
  * deserialized from JSON using nlohmann_json.
@@ -0,0 +1,153 @@
+#ifndef WRITE_BEHIND_QUEUE_H
+#define WRITE_BEHIND_QUEUE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include "database.h"
+
+// One audio clip to persist alongside a translation
+struct PendingAudio {
+    std::string voice;     // e.g. "mandarin", "cantonese"
+    std::string mimeType;  // e.g. "audio/mpeg"
+    std::string data;      // raw (decoded) audio bytes
+};
+
+// A translation result waiting to be written to MySQL
+struct PendingTranslation {
+    std::string originalText;
+    std::string englishMeaning;
+    std::string pinyinMandarin;
+    std::string jyutpingCantonese;
+    std::string equivalentCantonese;
+    std::vector<PendingAudio> audio;
+    unsigned attempts = 0;  // Failed writes of this item so far (not journaled)
+
+    // Approximate memory footprint, used for the queue's byte budget
+    size_t byteSize() const;
+};
+
+struct WriteBehindOptions {
+    // What enqueue() does once maxQueuedBytes is reached
+    enum class OverflowPolicy {
+        DropNewest,  // Reject the new item immediately
+        Block        // Wait up to blockTimeout for the writer to catch up, then drop
+    };
+
+    size_t maxQueuedBytes = 64 * 1024 * 1024;        // 64MB of pending writes
+    size_t maxBatchSize = 32;                        // Translations per transaction
+    std::chrono::milliseconds flushInterval{50};     // Max wait to fill a batch
+    std::chrono::milliseconds retryInterval{1000};   // Backoff after a failed batch
+    OverflowPolicy overflowPolicy = OverflowPolicy::DropNewest;
+    std::chrono::milliseconds blockTimeout{100};
+    std::string journalPath;                         // Empty disables the journal
+    size_t journalCompactBytes = 16 * 1024 * 1024;   // Compact a journal this large once mostly committed
+    unsigned maxAttempts = 5;                        // Failed writes before an item is dead-lettered
+    std::string deadLetterPath;                      // Empty only logs dead-lettered items
+};
+
+/**
+ * Background writer that persists translations without making the request
+ * thread wait on MySQL.
+ *
+ * Items are group-committed in batches (one transaction per batch) on a
+ * dedicated thread that owns its own Database session. When a journal path is
+ * configured, every accepted item is appended to a local file first and
+ * read back when the next queue is constructed, so a crash does not lose
+ * queued writes. The journal is truncated whenever the queue fully drains,
+ * and under steady load it is rewritten with only the uncommitted items once
+ * it passes journalCompactBytes and is mostly committed records.
+ *
+ * An item whose own write fails (a constraint or data error rather than a
+ * lost connection) is retried up to maxAttempts times. After that it is
+ * removed from the queue and the journal and appended to the dead-letter
+ * file in journal format, so one bad record can't hold up every write behind
+ * it. Attempts are not journaled, so after a crash a record that was still
+ * being retried starts over.
+ */
+class WriteBehindQueue {
+public:
+    WriteBehindQueue();
+    explicit WriteBehindQueue(const WriteBehindOptions& options);
+    ~WriteBehindQueue();
+
+    WriteBehindQueue(const WriteBehindQueue&) = delete;
+    WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+    // Start the writer thread; items recovered from the journal by the
+    // constructor are written first
+    bool start();
+
+    // Stop the writer thread after draining what can still be written
+    void stop();
+
+    /**
+     * Queue a translation for persistence.
+     *
+     * Runs on the caller's thread: with a journal it appends and flushes the
+     * record, and with OverflowPolicy::Block on a full queue it waits up to
+     * blockTimeout for space. Callers that must never block should use
+     * DropNewest.
+     *
+     * @return false if the item was dropped because the queue is full
+     */
+    bool enqueue(PendingTranslation item);
+
+    /**
+     * Wait until every queued item has been committed.
+     *
+     * @return false on timeout
+     */
+    bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+    // Counters
+    size_t pendingCount() const;
+    size_t committedCount() const { return m_committed.load(); }
+    size_t droppedCount() const { return m_dropped.load(); }
+    size_t failedBatchCount() const { return m_failedBatches.load(); }
+    size_t deadLetteredCount() const { return m_deadLettered.load(); }
+
+private:
+    void run();
+    // On failure, failedItem is the index of the item that failed, or
+    // batch.size() if the failure wasn't specific to one item
+    bool writeBatch(const std::vector<PendingTranslation>& batch, size_t& failedItem);
+    void deadLetter(const PendingTranslation& item);  // Called without m_mutex
+
+    // Journal helpers (called with m_mutex held)
+    bool openJournal();
+    void appendToJournal(const PendingTranslation& item);
+    void truncateJournal();
+    size_t replayJournal();
+    // Writer thread only; releases the lock while writing the new file
+    void compactJournal(std::unique_lock<std::mutex>& lock);
+
+    WriteBehindOptions m_options;
+    Database m_db;  // Only touched by the writer thread
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_itemsAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::condition_variable m_drained;
+    std::deque<PendingTranslation> m_queue;
+    size_t m_queuedBytes;
+    size_t m_inFlight;
+    bool m_running;
+    bool m_stopRequested;
+    std::thread m_worker;
+    std::ofstream m_journal;
+    size_t m_journalBytes;  // Current size of the journal file
+
+    std::atomic<size_t> m_committed;
+    std::atomic<size_t> m_dropped;
+    std::atomic<size_t> m_failedBatches;
+    std::atomic<size_t> m_deadLettered;
+};
+
+#endif // WRITE_BEHIND_QUEUE_H
@@ -0,0 +1,134 @@
+#include "../include/bloom_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+// Snapshot header: magic, version, bit count, hash count, item count
+static const char SNAPSHOT_MAGIC[4] = {'H', 'S', 'B', 'F'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+BloomFilter::BloomFilter(size_t expectedItems, double falsePositiveRate)
+    : m_itemCount(0) {
+    expectedItems = std::max<size_t>(expectedItems, 1);
+    falsePositiveRate = std::min(std::max(falsePositiveRate, 1e-9), 0.5);
+
+    // Optimal size and hash count: m = -n ln(p) / ln(2)^2, k = (m / n) ln(2)
+    const double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(expectedItems) * std::log(falsePositiveRate) / (ln2 * ln2);
+
+    m_wordCount = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / 64.0)));
+    m_bitCount = m_wordCount * 64;
+    m_hashCount = std::max<size_t>(1, static_cast<size_t>(std::round(
+        static_cast<double>(m_bitCount) / expectedItems * ln2)));
+
+    m_words = std::make_unique<std::atomic<uint64_t>[]>(m_wordCount);
+    clear();
+}
+
+void BloomFilter::baseHashes(std::string_view key, uint64_t& h1, uint64_t& h2) {
+    if (key.size() >= 2 * sizeof(uint64_t)) {
+        std::memcpy(&h1, key.data(), sizeof(h1));
+        std::memcpy(&h2, key.data() + sizeof(h1), sizeof(h2));
+    } else {
+        // Short keys aren't digests, so spread them first
+        h1 = std::hash<std::string_view>()(key);
+        h2 = h1 * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+    }
+    // An odd step visits distinct positions for every i
+    h2 |= 1;
+}
+
+void BloomFilter::add(std::string_view key) {
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    baseHashes(key, h1, h2);
+
+    for (size_t i = 0; i < m_hashCount; ++i) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        m_words[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_relaxed);
+    }
+    m_itemCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BloomFilter::mightContain(std::string_view key) const {
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    baseHashes(key, h1, h2);
+
+    for (size_t i = 0; i < m_hashCount; ++i) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        if ((m_words[bit / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilter::clear() {
+    for (size_t i = 0; i < m_wordCount; ++i) {
+        m_words[i].store(0, std::memory_order_relaxed);
+    }
+    m_itemCount.store(0);
+}
+
+bool BloomFilter::saveSnapshot(const std::string& path) const {
+    // Write to a temporary file and rename so a crash never leaves a torn snapshot
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    uint64_t header[3] = {m_bitCount, m_hashCount, m_itemCount.load()};
+    out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    out.write(reinterpret_cast<const char*>(&SNAPSHOT_VERSION), sizeof(SNAPSHOT_VERSION));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<uint64_t> words(m_wordCount);
+    for (size_t i = 0; i < m_wordCount; ++i) {
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+    }
+    out.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+    out.close();
+
+    if (!out) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool BloomFilter::loadSnapshot(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t header[3] = {0, 0, 0};
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    if (!in || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+        version != SNAPSHOT_VERSION || header[0] != m_bitCount || header[1] != m_hashCount) {
+        return false;
+    }
+
+    std::vector<uint64_t> words(m_wordCount);
+    in.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint64_t));
+    if (!in) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_wordCount; ++i) {
+        m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_itemCount.store(static_cast<size_t>(header[2]));
+    return true;
+}
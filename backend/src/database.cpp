@@ -4,6 +4,12 @@
 #include <cstdlib> // For getenv
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
+#include <openssl/evp.h>
+#include <thread>
+#include <deque>
+#include <functional>
+#include <condition_variable>
 
 // Module-level static logger initialization
 static std::shared_ptr<spdlog::logger> getDBLogger() {
@@ -19,7 +25,133 @@ static std::shared_ptr<spdlog::logger> getDBLogger() {
 #define DB_LOG_ERROR(...) SPDLOG_LOGGER_ERROR(getDBLogger(), __VA_ARGS__)
 #define DB_LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(getDBLogger(), __VA_ARGS__)
 
-Database::Database() : port(33060) {
+// UTF-8 encoding of U+3000 IDEOGRAPHIC SPACE, common in copied CJK text
+static const std::string kIdeographicSpace = "\xE3\x80\x80";
+
+static bool isAsciiSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Strip surrounding ASCII and ideographic whitespace so copies with stray
+// spaces or newlines map to the same row
+static std::string canonicalText(const std::string& text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    
+    while (begin < end) {
+        if (isAsciiSpace(text[begin])) {
+            begin += 1;
+        } else if (text.compare(begin, kIdeographicSpace.size(), kIdeographicSpace) == 0) {
+            begin += kIdeographicSpace.size();
+        } else {
+            break;
+        }
+    }
+    
+    while (end > begin) {
+        if (isAsciiSpace(text[end - 1])) {
+            end -= 1;
+        } else if (end - begin >= kIdeographicSpace.size() &&
+                   text.compare(end - kIdeographicSpace.size(), kIdeographicSpace.size(), kIdeographicSpace) == 0) {
+            end -= kIdeographicSpace.size();
+        } else {
+            break;
+        }
+    }
+    
+    return text.substr(begin, end - begin);
+}
+
+static std::string sha256(std::string_view data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    EVP_Digest(data.data(), data.size(), digest, &digestLength, EVP_sha256(), nullptr);
+    return std::string(reinterpret_cast<const char*>(digest), digestLength);
+}
+
+// View a binary string as an X DevAPI blob parameter
+static mysqlx::bytes asBytes(std::string_view data) {
+    return mysqlx::bytes(reinterpret_cast<const mysqlx::byte*>(data.data()), data.size());
+}
+
+std::string Database::textHash(const std::string& originalText) {
+    return sha256(canonicalText(originalText));
+}
+
+// Shared by every Database instance (request path, write-behind, executors)
+static std::shared_ptr<BloomFilter> s_translationFilter;
+
+void Database::setTranslationFilter(std::shared_ptr<BloomFilter> filter) {
+    std::atomic_store(&s_translationFilter, std::move(filter));
+}
+
+std::shared_ptr<BloomFilter> Database::translationFilter() {
+    return std::atomic_load(&s_translationFilter);
+}
+
+bool Database::mightHaveTranslation(const std::string& originalText) {
+    std::shared_ptr<BloomFilter> filter = translationFilter();
+    return !filter || filter->mightContain(textHash(originalText));
+}
+
+// Fixed pool of worker threads for the async methods. Each worker owns a
+// separate Database (and so a separate session), since a session must not be
+// shared between threads.
+class Database::AsyncExecutor {
+public:
+    explicit AsyncExecutor(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            m_workers.emplace_back(&AsyncExecutor::run, this);
+        }
+    }
+    
+    ~AsyncExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_taskAvailable.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+    
+    void submit(std::function<void(Database&)> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_taskAvailable.notify_one();
+    }
+    
+private:
+    void run() {
+        Database workerDb;
+        
+        while (true) {
+            std::function<void(Database&)> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+                // Drain queued tasks before exiting so no future is left broken
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task(workerDb);
+        }
+    }
+    
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    std::deque<std::function<void(Database&)>> m_tasks;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+Database::Database() : port(33060), m_asyncPoolSize(2) {
     // Constructor code
     DB_LOG_DEBUG("Database instance created");
     
@@ -27,6 +159,8 @@ Database::Database() : port(33060) {
 }
 
 Database::~Database() {
+    // Finish outstanding async work before tearing down
+    m_executor.reset();
     disconnect();
 }
 
@@ -99,34 +233,40 @@ bool Database::storeTranslation(const std::string& originalText,
                               const std::string& englishMeaning,
                               const std::string& pinyinMandarin,
                               const std::string& jyutpingCantonese,
-                              const std::string& equivalentCantonese,
-                              int audioFileId) {
+                              const std::string& equivalentCantonese) {
     if (!isConnected() && !connect()) {
         return false;
     }
     
     try {
+        std::string canonical = canonicalText(originalText);
+        std::string hash = sha256(canonical);
+        
         // Using SQL instead of Collections to match schema
         std::string query = "INSERT INTO translations "
-                            "(original_text, english_meaning, pinyin_mandarin, "
-                            "jyutping_cantonese, equivalent_cantonese, audio_file_id) "
+                            "(text_hash, original_text, english_meaning, pinyin_mandarin, "
+                            "jyutping_cantonese, equivalent_cantonese) "
                             "VALUES (?, ?, ?, ?, ?, ?) "
                             "ON DUPLICATE KEY UPDATE "
                             "english_meaning = VALUES(english_meaning), "
                             "pinyin_mandarin = VALUES(pinyin_mandarin), "
                             "jyutping_cantonese = VALUES(jyutping_cantonese), "
-                            "equivalent_cantonese = VALUES(equivalent_cantonese), "
-                            "audio_file_id = VALUES(audio_file_id)";
+                            "equivalent_cantonese = VALUES(equivalent_cantonese)";
                             
         auto stmt = session->sql(query)
-                         .bind(originalText)
+                         .bind(asBytes(hash))
+                         .bind(canonical)
                          .bind(englishMeaning)
                          .bind(pinyinMandarin)
                          .bind(jyutpingCantonese)
-                         .bind(equivalentCantonese)
-                         .bind(audioFileId);
+                         .bind(equivalentCantonese);
         
         stmt.execute();
+        
+        if (std::shared_ptr<BloomFilter> filter = translationFilter()) {
+            filter->add(hash);
+        }
+        
         DB_LOG_INFO("Successfully stored translation");
         return true;
     }
@@ -136,34 +276,73 @@ bool Database::storeTranslation(const std::string& originalText,
     }
 }
 
-bool Database::getTranslation(const std::string& originalText,
-                            std::string& englishMeaning,
-                            std::string& pinyinMandarin,
-                            std::string& jyutpingCantonese,
-                            std::string& equivalentCantonese,
-                            int& audioFileId) {
+bool Database::storeTranslationAudio(const std::string& originalText,
+                                   const std::string& voice,
+                                   int audioFileId) {
     if (!isConnected() && !connect()) {
         return false;
     }
     
     try {
-        std::string query = "SELECT english_meaning, pinyin_mandarin, "
-                            "jyutping_cantonese, equivalent_cantonese, audio_file_id "
-                            "FROM translations WHERE original_text = ?";
-                            
-        auto result = session->sql(query).bind(originalText).execute();
+        std::string query = "INSERT INTO translation_audio (text_hash, voice, audio_file_id) "
+                            "VALUES (?, ?, ?) "
+                            "ON DUPLICATE KEY UPDATE audio_file_id = VALUES(audio_file_id)";
         
-        if (result.count() > 0) {
-            auto row = result.fetchOne();
-            englishMeaning = row[0].get<std::string>();
-            pinyinMandarin = row[1].get<std::string>();
-            jyutpingCantonese = row[2].get<std::string>();
-            equivalentCantonese = row[3].get<std::string>();
-            audioFileId = row[4].isNull() ? -1 : row[4].get<int>();
-            return true;
-        } else {
-            return false; // No translation found
+        std::string hash = textHash(originalText);
+        session->sql(query).bind(asBytes(hash)).bind(voice).bind(audioFileId).execute();
+        
+        DB_LOG_INFO("Linked audio file {} to translation for voice {}", audioFileId, voice);
+        return true;
+    }
+    catch (const std::exception &e) {
+        DB_LOG_ERROR("Error in storeTranslationAudio: {}", e.what());
+        return false;
+    }
+}
+
+bool Database::getTranslation(const std::string& originalText, TranslationRecord& record) {
+    std::string hash = textHash(originalText);
+    
+    // Never-seen text is a guaranteed miss, so skip the round trip
+    std::shared_ptr<BloomFilter> filter = translationFilter();
+    if (filter && !filter->mightContain(hash)) {
+        DB_LOG_DEBUG("Translation filter miss, skipping database lookup");
+        return false;
+    }
+    
+    if (!isConnected() && !connect()) {
+        return false;
+    }
+    
+    try {
+        // One primary-key probe; the LEFT JOIN yields one row per linked voice
+        std::string query = "SELECT t.original_text, t.english_meaning, t.pinyin_mandarin, "
+                            "t.jyutping_cantonese, t.equivalent_cantonese, "
+                            "a.voice, a.audio_file_id "
+                            "FROM translations t "
+                            "LEFT JOIN translation_audio a ON a.text_hash = t.text_hash "
+                            "WHERE t.text_hash = ?";
+        
+        auto result = session->sql(query).bind(asBytes(hash)).execute();
+        
+        bool found = false;
+        for (auto row : result) {
+            if (!found) {
+                record.originalText = row[0].get<std::string>();
+                record.englishMeaning = row[1].get<std::string>();
+                record.pinyinMandarin = row[2].get<std::string>();
+                record.jyutpingCantonese = row[3].get<std::string>();
+                record.equivalentCantonese = row[4].get<std::string>();
+                record.audioFileIds.clear();
+                found = true;
+            }
+            
+            if (!row[5].isNull()) {
+                record.audioFileIds[row[5].get<std::string>()] = row[6].get<int>();
+            }
         }
+        
+        return found; // false when no translation found
     }
     catch (const std::exception &e) {
         DB_LOG_ERROR("Error in getTranslation: {}", e.what());
@@ -171,39 +350,88 @@ bool Database::getTranslation(const std::string& originalText,
     }
 }
 
-int Database::storeAudioFile(const std::string& mimeType, const std::string& audioFilePath) {
+long long Database::loadTranslationKeys(BloomFilter& filter) {
     if (!isConnected() && !connect()) {
         return -1;
     }
     
     try {
-        // Read audio data from file
-        std::ifstream audioFile(audioFilePath, std::ios::binary);
-        if (!audioFile) {
-            DB_LOG_ERROR("Could not open audio file: {}", audioFilePath);
+        // Rows are consumed as they arrive rather than materialized up front
+        auto result = session->sql("SELECT text_hash FROM translations").execute();
+        
+        long long count = 0;
+        for (auto row : result) {
+            mysqlx::bytes key = row[0].getRawBytes();
+            filter.add(std::string_view(reinterpret_cast<const char*>(key.begin()), key.size()));
+            count++;
+        }
+        
+        DB_LOG_INFO("Loaded {} translation keys into filter", count);
+        return count;
+    }
+    catch (const std::exception &e) {
+        DB_LOG_ERROR("Error in loadTranslationKeys: {}", e.what());
+        return -1;
+    }
+}
+
+int Database::storeAudioFile(const std::string& mimeType, const std::string& audioFilePath) {
+    // Open at the end so the file size is known up front
+    std::ifstream audioFile(audioFilePath, std::ios::binary | std::ios::ate);
+    if (!audioFile) {
+        DB_LOG_ERROR("Could not open audio file: {}", audioFilePath);
+        return -1;
+    }
+    
+    std::streamsize fileSize = audioFile.tellg();
+    audioFile.seekg(0, std::ios::beg);
+    
+    // Read in fixed-size chunks straight into a pre-sized buffer
+    std::string audioData(static_cast<size_t>(fileSize), '\0');
+    const std::streamsize chunkSize = 64 * 1024;
+    std::streamsize offset = 0;
+    while (offset < fileSize) {
+        std::streamsize toRead = std::min(chunkSize, fileSize - offset);
+        if (!audioFile.read(&audioData[static_cast<size_t>(offset)], toRead)) {
+            DB_LOG_ERROR("Failed to read audio file: {}", audioFilePath);
             return -1;
         }
+        offset += toRead;
+    }
+    audioFile.close();
+    
+    return storeAudioData(mimeType, audioData);
+}
+
+int Database::storeAudioData(const std::string& mimeType, std::string_view audioData) {
+    if (!isConnected() && !connect()) {
+        return -1;
+    }
+    
+    try {
+        // Identical clips of the same type (e.g. the same phrase synthesized twice) share
+        // one row; LAST_INSERT_ID(id) makes a duplicate report the existing row's ID
+        std::string contentHash = sha256(audioData);
         
-        // Read file into string buffer
-        std::string audioData((std::istreambuf_iterator<char>(audioFile)),
-                              std::istreambuf_iterator<char>());
-        audioFile.close();
+        std::string query = "INSERT INTO audio_files (content_hash, mime_type, audio_data) "
+                            "VALUES (?, ?, ?) "
+                            "ON DUPLICATE KEY UPDATE id = LAST_INSERT_ID(id)";
         
-        // Use SQL to insert audio blob
-        std::string query = "INSERT INTO audio_files (mime_type, audio_data) VALUES (?, ?)";
-        auto stmt = session->sql(query).bind(mimeType).bind(audioData);
-        auto result = stmt.execute();
+        // Bind the caller's buffer directly as a blob instead of copying it into a string
+        auto result = session->sql(query)
+                             .bind(asBytes(contentHash))
+                             .bind(mimeType)
+                             .bind(asBytes(audioData))
+                             .execute();
         
-        // Get the last inserted ID
-        auto idResult = session->sql("SELECT LAST_INSERT_ID()").execute();
-        auto row = idResult.fetchOne();
-        int audioFileId = row[0].get<int>();
+        // The insert result already carries the generated ID, no LAST_INSERT_ID() round trip
+        int audioFileId = static_cast<int>(result.getAutoIncrementValue());
         
         DB_LOG_INFO("Successfully stored audio file with ID: {}", audioFileId);
         return audioFileId;
     }
     catch (const std::exception &e) {
-        DB_LOG_ERROR("Error in storeAudioFile: {}", e.what());
+        DB_LOG_ERROR("Error in storeAudioData: {}", e.what());
         return -1;
     }
 }
@@ -230,4 +458,85 @@ bool Database::getAudioData(int audioFileId, std::string& mimeType, std::string&
         DB_LOG_ERROR("Error in getAudioData: {}", e.what());
         return false;
     }
-} 
\ No newline at end of file
+} 
+
+// ASYNC OPERATIONS
+
+void Database::setAsyncPoolSize(size_t threads) {
+    std::lock_guard<std::mutex> lock(m_executorMutex);
+    m_asyncPoolSize = std::max<size_t>(1, threads);
+}
+
+Database::AsyncExecutor& Database::executor() {
+    std::lock_guard<std::mutex> lock(m_executorMutex);
+    if (!m_executor) {
+        DB_LOG_DEBUG("Starting async database executor with {} sessions", m_asyncPoolSize);
+        m_executor = std::make_unique<AsyncExecutor>(m_asyncPoolSize);
+    }
+    return *m_executor;
+}
+
+template <typename Result, typename Task>
+std::future<Result> Database::runAsync(Task task) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    
+    executor().submit([promise, task = std::move(task)](Database& workerDb) mutable {
+        try {
+            promise->set_value(task(workerDb));
+        }
+        catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    
+    return future;
+}
+
+std::future<std::optional<TranslationRecord>> Database::getTranslationAsync(std::string originalText) {
+    return runAsync<std::optional<TranslationRecord>>(
+        [originalText = std::move(originalText)](Database& workerDb) -> std::optional<TranslationRecord> {
+            TranslationRecord record;
+            if (!workerDb.getTranslation(originalText, record)) {
+                return std::nullopt;
+            }
+            return record;
+        });
+}
+
+std::future<bool> Database::storeTranslationAsync(TranslationRecord record) {
+    return runAsync<bool>([record = std::move(record)](Database& workerDb) {
+        if (!workerDb.storeTranslation(record.originalText,
+                                       record.englishMeaning,
+                                       record.pinyinMandarin,
+                                       record.jyutpingCantonese,
+                                       record.equivalentCantonese)) {
+            return false;
+        }
+        
+        for (const auto& [voice, audioFileId] : record.audioFileIds) {
+            if (!workerDb.storeTranslationAudio(record.originalText, voice, audioFileId)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+std::future<int> Database::storeAudioDataAsync(std::string mimeType, std::string audioData) {
+    return runAsync<int>(
+        [mimeType = std::move(mimeType), audioData = std::move(audioData)](Database& workerDb) {
+            return workerDb.storeAudioData(mimeType, audioData);
+        });
+}
+
+std::future<std::optional<AudioRecord>> Database::getAudioDataAsync(int audioFileId) {
+    return runAsync<std::optional<AudioRecord>>(
+        [audioFileId](Database& workerDb) -> std::optional<AudioRecord> {
+            AudioRecord audio;
+            if (!workerDb.getAudioData(audioFileId, audio.mimeType, audio.data)) {
+                return std::nullopt;
+            }
+            return audio;
+        });
+}
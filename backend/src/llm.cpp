@@ -135,7 +135,7 @@ std::string callChatGPTForJSON(const std::string& prompt, const json& schemaJson
 std::string extractJSONContent(const std::string& rawResponse) {
     try {
         LLM_LOG_INFO("3333333333333333333");
-        LLM_LOG_INFO("Raw API response: {}", rawResponse);
+        LLM_LOG_PAYLOAD(DEBUG, "Raw API response", rawResponse);
         
         json response = json::parse(rawResponse);
         
@@ -161,7 +161,7 @@ std::string extractJSONContent(const std::string& rawResponse) {
                 
                 // Just return the parsed content without adding audio
                 std::string jsonString = parsed.dump();
-                LLM_LOG_INFO("Extracted JSON content: {}", jsonString);
+                LLM_LOG_PAYLOAD(INFO, "Extracted JSON content", jsonString);
                 return jsonString;
                 
             } catch (const json::parse_error& e) {
@@ -236,7 +236,7 @@ std::string generateSpeech(const std::string& text, const std::string& language,
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
 
-    LLM_LOG_INFO("Generating speech for text: {}", text);
+    LLM_LOG_PAYLOAD(INFO, "Generating speech for text", text);
     
     // Perform the request
     CURLcode res = curl_easy_perform(curl);
@@ -264,20 +264,7 @@ std::string generateSpeech(const std::string& text, const std::string& language,
     }
     
     // Convert binary data to base64
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO* mem = BIO_new(BIO_s_mem());
-    BIO_push(b64, mem);
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    
-    BIO_write(b64, response_data.data(), response_data.size());
-    BIO_flush(b64);
-    
-    BUF_MEM* bptr;
-    BIO_get_mem_ptr(b64, &bptr);
-    
-    std::string base64_audio(bptr->data, bptr->length);
-    
-    BIO_free_all(b64);
+    std::string base64_audio = base64_encode(response_data);
     
     LLM_LOG_INFO("Generated base64 audio data of length: {}", base64_audio.length());
     return base64_audio;
@@ -296,7 +283,7 @@ json generateAudioLinks(const json& jsonResponse) {
     std::string mandarinText = "";
     std::string cantoneseText = "";
 
-    LLM_LOG_DEBUG("JSON Response: {}", result.dump());
+    LLM_LOG_PAYLOAD(DEBUG, "JSON Response", result.dump());
     
     if (result.contains("original_text")) {
         mandarinText = result["original_text"].get<std::string>();
@@ -368,7 +355,7 @@ std::string generateSpeechGoogle(const std::string& text, const std::string& lan
     };
     
     std::string json_payload = payload.dump();
-    LLM_LOG_DEBUG("Google TTS request payload: {}", json_payload);
+    LLM_LOG_PAYLOAD(DEBUG, "Google TTS request payload", json_payload);
     
     // Google Cloud TTS endpoint
     std::string url = "https://texttospeech.googleapis.com/v1/text:synthesize?key=";
@@ -385,7 +372,7 @@ std::string generateSpeechGoogle(const std::string& text, const std::string& lan
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
 
-    LLM_LOG_INFO("Generating speech with Google TTS for text: {}", text);
+    LLM_LOG_PAYLOAD(INFO, "Generating speech with Google TTS for text", text);
     
     // Perform the request
     CURLcode res = curl_easy_perform(curl);
@@ -405,7 +392,7 @@ std::string generateSpeechGoogle(const std::string& text, const std::string& lan
         
         // Google returns base64-encoded audio content
         if (!response.contains("audioContent")) {
-            LLM_LOG_ERROR("Google TTS API response missing audioContent: {}", response_data);
+            LLM_LOG_PAYLOAD(ERROR, "Google TTS API response missing audioContent", response_data);
             return "";
         }
         
@@ -434,6 +421,30 @@ std::string generateSpeechGoogle(const std::string& text, const std::string& lan
     }
 }
 
+/**
+ * Helper function to encode binary data as a base64 string
+ * 
+ * @param data The binary data
+ * @return The base64-encoded string (no line breaks)
+ */
+std::string base64_encode(const std::string& data) {
+    BIO* b64 = BIO_new(BIO_f_base64());
+    BIO* mem = BIO_new(BIO_s_mem());
+    BIO_push(b64, mem);
+    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
+    
+    BIO_write(b64, data.data(), data.size());
+    BIO_flush(b64);
+    
+    BUF_MEM* bptr;
+    BIO_get_mem_ptr(b64, &bptr);
+    
+    std::string encoded(bptr->data, bptr->length);
+    
+    BIO_free_all(b64);
+    return encoded;
+}
+
 /**
  * Helper function to decode base64 string to binary data
  * 
@@ -470,7 +481,7 @@ json addAudioToJson(const json& translationJson) {
     std::string mandarinText = "";
     std::string cantoneseText = "";
     
-    LLM_LOG_DEBUG("Adding audio to translation JSON: {}", result.dump());
+    LLM_LOG_PAYLOAD(DEBUG, "Adding audio to translation JSON", result.dump());
     
     if (result.contains("original_text")) {
         mandarinText = result["original_text"].get<std::string>();
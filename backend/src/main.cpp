@@ -1,6 +1,17 @@
 #include <drogon/drogon.h>
 #include <curl/curl.h>  // Add this for CURL_GLOBAL_ALL
 #include "../include/llm.h"  // Include the LLM header
+#include "../include/write_behind_queue.h"
+#include <trantor/utils/ConcurrentTaskQueue.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
 #include "../../common/include/logger.h"
 
 // Module-level static logger initialization for main
@@ -17,7 +28,176 @@ static std::shared_ptr<spdlog::logger> getMainLogger() {
 #define MAIN_LOG_ERROR(...) SPDLOG_LOGGER_ERROR(getMainLogger(), __VA_ARGS__)
 #define MAIN_LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(getMainLogger(), __VA_ARGS__)
 
+// Threads that run the blocking parts of /llm (upstream LLM and TTS calls,
+// waits on database futures) so Drogon's event loops never block on them
+static const size_t LLM_WORKER_THREADS = 16;
+
+// How long /llm waits for the cache probe before going upstream anyway
+static const std::chrono::milliseconds CACHE_PROBE_BUDGET(100);
+
+/**
+ * One /llm request. It is served on a worker thread and the response is
+ * posted back to the request's event loop.
+ */
+struct LlmExchange {
+    std::string text;
+    std::function<void(const drogon::HttpResponsePtr&)> callback;
+    trantor::EventLoop* loop;
+    std::atomic<bool> answered{false};
+    
+    // Send the response unless one was already sent; returns false if it was
+    bool respond(const json& body, drogon::HttpStatusCode status = drogon::k200OK) {
+        if (answered.exchange(true)) {
+            return false;
+        }
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(status);
+        resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+        resp->setBody(body.dump());
+        loop->queueInLoop([callback = std::move(callback), resp]() { callback(resp); });
+        return true;
+    }
+};
+
+/**
+ * Build the /llm response from a cached translation, fetching its audio
+ * clips from the database in parallel. Blocks, so only call it on a worker
+ * thread.
+ */
+static json buildCachedResponse(Database& cacheDb, const TranslationRecord& record, const std::string& text) {
+    json result = {
+        {"original_text", record.originalText},
+        {"meaning_english", record.englishMeaning},
+        {"pinyin_mandarin", record.pinyinMandarin},
+        {"jyutping_cantonese", record.jyutpingCantonese},
+        {"equivalent_cantonese", record.equivalentCantonese}
+    };
+    
+    std::map<std::string, std::future<std::optional<AudioRecord>>> audioFetches;
+    for (const auto& [voice, audioFileId] : record.audioFileIds) {
+        audioFetches.emplace(voice, cacheDb.getAudioDataAsync(audioFileId));
+    }
+    
+    // Same keys as addAudioToJson: mandarin_audio_data, cantonese_audio_data
+    for (auto& [voice, fetch] : audioFetches) {
+        std::optional<AudioRecord> clip = fetch.get();
+        if (clip) {
+            result[voice + "_audio_data"] = base64_encode(clip->data);
+        }
+    }
+    
+    return json{
+        {"translation", json{
+            {"text", text},
+            {"result", result}
+        }}
+    };
+}
+
+/**
+ * Answer from the cache if the text is stored and the probe comes back
+ * within CACHE_PROBE_BUDGET. Returns false on a miss, an error or a slow
+ * database, leaving the request to the upstream call.
+ */
+static bool serveFromCache(LlmExchange& exchange, Database& cacheDb) {
+    try {
+        std::future<std::optional<TranslationRecord>> probe = cacheDb.getTranslationAsync(exchange.text);
+        if (probe.wait_for(CACHE_PROBE_BUDGET) != std::future_status::ready) {
+            MAIN_LOG_DEBUG("Cache probe exceeded {} ms, going upstream", CACHE_PROBE_BUDGET.count());
+            return false;
+        }
+        std::optional<TranslationRecord> cached = probe.get();
+        if (!cached) {
+            return false;
+        }
+        exchange.respond(buildCachedResponse(cacheDb, *cached, exchange.text));
+        MAIN_LOG_INFO("Serving translation from cache");
+        return true;
+    } catch (const std::exception& e) {
+        MAIN_LOG_WARNING("Cache probe failed: {}", e.what());
+        return false;
+    }
+}
+
+/**
+ * Translate through the LLM, add TTS audio and queue the result for
+ * persistence.
+ */
+static void serveFromUpstream(LlmExchange& exchange, WriteBehindQueue* writeQueue) {
+    const std::string& text = exchange.text;
+    try {
+        // Create prompt for translation
+        std::string prompt = "Translate the Chinese text \n\n'" + text + "'\n\nto English. Include:\n"
+                            "- English meaning\n"
+                            "- Mandarin pronunciation (pinyin)\n"
+                            "- Cantonese pronunciation (jyutping)\n"
+                            "- Cantonese equivalent phrase if different from input";
+        
+        // Get translation
+        Translation translation = getStructuredResponse<Translation>(prompt);
+        
+        // Convert Translation to JSON
+        json translationJson = translation;
+        
+        // Add original text to the translation JSON
+        translationJson["original_text"] = text;
+        
+        // Add audio data to the translation JSON
+        json enhancedJson = addAudioToJson(translationJson);
+        
+        // Wrap with original text in the final response
+        json responseJson = {
+            {"translation", json{
+                {"text", text},           // Add the original text
+                {"result", enhancedJson}  // The enhanced translation
+            }}
+        };
+        
+        if (!exchange.respond(responseJson)) {
+            return;
+        }
+        
+        // Queue the result for persistence now that the response is on its way
+        if (writeQueue && !translation.meaning_english.empty()) {
+            try {
+                PendingTranslation pending;
+                pending.originalText = text;
+                pending.englishMeaning = translation.meaning_english;
+                pending.pinyinMandarin = translation.pinyin_mandarin;
+                pending.jyutpingCantonese = translation.jyutping_cantonese;
+                pending.equivalentCantonese = translation.equivalent_cantonese;
+                
+                if (enhancedJson.contains("mandarin_audio_data")) {
+                    pending.audio.push_back({"mandarin", "audio/mpeg",
+                        base64_decode(enhancedJson["mandarin_audio_data"].get<std::string>())});
+                }
+                if (enhancedJson.contains("cantonese_audio_data")) {
+                    pending.audio.push_back({"cantonese", "audio/mpeg",
+                        base64_decode(enhancedJson["cantonese_audio_data"].get<std::string>())});
+                }
+                
+                writeQueue->enqueue(std::move(pending));
+            } catch (const std::exception& e) {
+                // The response was already sent, so only log
+                MAIN_LOG_ERROR("Failed to queue translation for persistence: {}", e.what());
+            }
+        }
+    } catch (const std::exception& e) {
+        json errorJson = {
+            {"error", std::string("Exception: ") + e.what()}
+        };
+        exchange.respond(errorJson, drogon::k500InternalServerError);
+    }
+}
+
 int main() {
+    // Log through a background thread so request threads never wait on
+    // console or disk I/O. Set HANSNAP_LOG_SYNC=1 to log synchronously.
+    const char* log_sync = std::getenv("HANSNAP_LOG_SYNC");
+    if (!log_sync || std::string(log_sync) != "1") {
+        hansnap::Logger::getInstance().enableAsync();
+    }
+    
     // Initialize the main logger
     hansnap::Logger::getInstance().initialize("hansnap_backend");
     
@@ -32,6 +212,20 @@ int main() {
         }
     }
     
+    // Bound how much of each request/response body reaches the log
+    hansnap::Logger::PayloadOptions payloadOptions;
+    if (const char* payload_bytes = std::getenv("HANSNAP_LOG_PAYLOAD_BYTES")) {
+        payloadOptions.maxBytes = std::strtoul(payload_bytes, nullptr, 10);
+    }
+    if (const char* payload_sample = std::getenv("HANSNAP_LOG_PAYLOAD_SAMPLE")) {
+        payloadOptions.sampleEvery = std::strtoul(payload_sample, nullptr, 10);
+    }
+    if (const char* payload_hash = std::getenv("HANSNAP_LOG_PAYLOAD_HASH")) {
+        std::string value(payload_hash);
+        payloadOptions.includeHash = value == "1" || value == "true";
+    }
+    hansnap::Logger::getInstance().setPayloadOptions(payloadOptions);
+    
     // Add file logging
     hansnap::Logger::getInstance().addFileLogger("backend.log");
     
@@ -42,9 +236,65 @@ int main() {
     
     MAIN_LOG_INFO("Starting Hansnap backend server...");
     
+    // Drogon only listens on TCP, so when the desktop app runs on the same
+    // machine set HANSNAP_LISTEN_ADDRESS=127.0.0.1 (or front it with a Unix
+    // socket proxy) to keep it off the network.
+    const char* listen_address = std::getenv("HANSNAP_LISTEN_ADDRESS");
+    const char* listen_port = std::getenv("HANSNAP_LISTEN_PORT");
+    std::string address = listen_address ? listen_address : "0.0.0.0";
+    uint16_t port = 8080;
+    if (listen_port) {
+        char* end = nullptr;
+        errno = 0;
+        unsigned long value = std::strtoul(listen_port, &end, 10);
+        if (end == listen_port || *end != '\0' || errno == ERANGE || value < 1 || value > 65535) {
+            MAIN_LOG_CRITICAL("Invalid HANSNAP_LISTEN_PORT '{}': expected a port number from 1 to 65535",
+                              listen_port);
+            spdlog::shutdown();
+            return 1;
+        }
+        port = static_cast<uint16_t>(value);
+    }
+    
     // Initialize libcurl at application startup
     curl_global_init(CURL_GLOBAL_ALL);
 
+    // Serve repeats from MySQL and persist new results in the background so
+    // /llm never waits on database writes. Set HANSNAP_PERSIST=0 to run
+    // without a database.
+    std::unique_ptr<WriteBehindQueue> writeQueue;
+    std::unique_ptr<Database> cacheDb;
+    const char* persist = std::getenv("HANSNAP_PERSIST");
+    const char* filterSnapshot = std::getenv("HANSNAP_FILTER_SNAPSHOT");
+    std::string filterSnapshotPath = filterSnapshot ? filterSnapshot : "translation_filter.bin";
+    if (!persist || std::string(persist) != "0") {
+        cacheDb = std::make_unique<Database>();
+        
+        // Filter of stored texts so never-seen text skips the cache probe. The
+        // snapshot is only trusted once: it is removed after loading and
+        // rewritten on clean shutdown, so after a crash the filter is rebuilt.
+        auto filter = std::make_shared<BloomFilter>();
+        if (filter->loadSnapshot(filterSnapshotPath)) {
+            std::remove(filterSnapshotPath.c_str());
+            MAIN_LOG_INFO("Loaded translation filter snapshot ({} keys)", filter->itemCount());
+            Database::setTranslationFilter(filter);
+        } else if (cacheDb->loadTranslationKeys(*filter) >= 0) {
+            Database::setTranslationFilter(filter);
+        } else {
+            MAIN_LOG_WARNING("Translation filter unavailable, every request will probe the database");
+        }
+        
+        WriteBehindOptions writeOptions;
+        const char* journal = std::getenv("HANSNAP_WRITE_JOURNAL");
+        writeOptions.journalPath = journal ? journal : "backend_writes.journal";
+        writeOptions.deadLetterPath = writeOptions.journalPath + ".dead";
+        writeQueue = std::make_unique<WriteBehindQueue>(writeOptions);
+        writeQueue->start();
+    }
+
+    // Runs the blocking halves of /llm; see LLM_WORKER_THREADS
+    auto llmWorkers = std::make_unique<trantor::ConcurrentTaskQueue>(LLM_WORKER_THREADS, "llm_workers");
+
     // Health check route
     drogon::app().registerHandler("/health", 
         [](const drogon::HttpRequestPtr& req, 
@@ -68,7 +318,7 @@ int main() {
 
     // LLM route
     drogon::app().registerHandler("/llm", 
-        [](const drogon::HttpRequestPtr& req, 
+        [writeQueue = writeQueue.get(), cacheDb = cacheDb.get(), llmWorkers = llmWorkers.get()](const drogon::HttpRequestPtr& req, 
            std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
             
             MAIN_LOG_INFO("LLM route called");
@@ -112,40 +362,20 @@ int main() {
                     return;
                 }
                 
-                // Create prompt for translation
-                std::string prompt = "Translate the Chinese text \n\n'" + text + "'\n\nto English. Include:\n"
-                                    "- English meaning\n"
-                                    "- Mandarin pronunciation (pinyin)\n"
-                                    "- Cantonese pronunciation (jyutping)\n"
-                                    "- Cantonese equivalent phrase if different from input";
-
-                // Get translation
-                Translation translation = getStructuredResponse<Translation>(prompt);
-                
-                // Convert Translation to JSON
-                json translationJson = translation;
-
-                // Add original text to the translation JSON
-                translationJson["original_text"] = text;
-                
-                // Add audio data to the translation JSON
-                json enhancedJson = addAudioToJson(translationJson);
-                
-                // Wrap with original text in the final response
-                json responseJson = {
-                    {"translation", json{
-                        {"text", text},           // Add the original text
-                        {"result", enhancedJson}  // The enhanced translation
-                    }}
-                };
-
-                // Log the final response JSON before returning
-                std::string finalResponse = responseJson.dump();
-
-                // Set the JSON response
-                resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-                resp->setBody(responseJson.dump());
-                callback(resp);
+                // Serve off the event loop: the cache first, and the LLM only
+                // on a miss, an error or a probe slower than its budget, so a
+                // cache hit never pays for an upstream completion
+                auto exchange = std::make_shared<LlmExchange>();
+                exchange->text = std::move(text);
+                exchange->callback = std::move(callback);
+                exchange->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+                const bool probeCache = cacheDb && Database::mightHaveTranslation(exchange->text);
+                llmWorkers->runTaskInQueue([exchange, cacheDb, writeQueue, probeCache]() {
+                    if (probeCache && serveFromCache(*exchange, *cacheDb)) {
+                        return;
+                    }
+                    serveFromUpstream(*exchange, writeQueue);
+                });
                 
             } catch (const std::exception& e) {
                 json errorJson = {
@@ -159,8 +389,29 @@ int main() {
         },
         {drogon::Post});  // Specify that this is a POST endpoint
 
-    // Configure and run the server
-    drogon::app().addListener("0.0.0.0", 8080).run();
+    // Run the server
+    MAIN_LOG_INFO("Listening on {}:{}", address, port);
+    drogon::app().addListener(address, port).run();
+    
+    // Let in-flight requests finish before the database goes away
+    llmWorkers->stop();
+    
+    // Drain pending writes (anything left stays in the journal)
+    if (writeQueue) {
+        writeQueue->stop();
+    }
+    cacheDb.reset();
+    
+    if (std::shared_ptr<BloomFilter> filter = Database::translationFilter()) {
+        if (!filter->saveSnapshot(filterSnapshotPath)) {
+            MAIN_LOG_WARNING("Failed to save translation filter snapshot to {}", filterSnapshotPath);
+        }
+    }
+    
+    hansnap::Logger::PayloadStats payloadStats = hansnap::Logger::getInstance().getPayloadStats("llm");
+    MAIN_LOG_INFO("LLM payload logging: {} logged ({} of {} bytes), {} sampled out",
+                  payloadStats.logged, payloadStats.loggedBytes, payloadStats.payloadBytes,
+                  payloadStats.sampledOut);
     
     // Clean up libcurl at application shutdown
     curl_global_cleanup();
@@ -0,0 +1,484 @@
+#include "../include/write_behind_queue.h"
+#include "../../common/include/logger.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+// Module-level static logger initialization
+static std::shared_ptr<spdlog::logger> getWriterLogger() {
+    static std::shared_ptr<spdlog::logger> logger = hansnap::Logger::getInstance().createLogger("db_writer");
+    return logger;
+}
+
+// Convenience macros
+#define WRITER_LOG_DEBUG(...) SPDLOG_LOGGER_DEBUG(getWriterLogger(), __VA_ARGS__)
+#define WRITER_LOG_INFO(...) SPDLOG_LOGGER_INFO(getWriterLogger(), __VA_ARGS__)
+#define WRITER_LOG_WARNING(...) SPDLOG_LOGGER_WARN(getWriterLogger(), __VA_ARGS__)
+#define WRITER_LOG_ERROR(...) SPDLOG_LOGGER_ERROR(getWriterLogger(), __VA_ARGS__)
+
+size_t PendingTranslation::byteSize() const {
+    size_t total = sizeof(PendingTranslation) + originalText.size() + englishMeaning.size() +
+                   pinyinMandarin.size() + jyutpingCantonese.size() + equivalentCantonese.size();
+    for (const auto& clip : audio) {
+        total += sizeof(PendingAudio) + clip.voice.size() + clip.mimeType.size() + clip.data.size();
+    }
+    return total;
+}
+
+// JOURNAL ENCODING
+//
+// Each record is a uint32 payload length followed by the payload: the five
+// text fields, an audio count, then voice/mime/data per clip. Every field is a
+// uint32 length followed by its bytes. A record cut short by a crash is
+// detected by its length running past the end of the file and is ignored.
+
+static void putLength(std::string& out, size_t length) {
+    uint32_t value = static_cast<uint32_t>(length);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static bool getLength(const std::string& in, size_t& pos, uint32_t& length) {
+    if (pos + sizeof(length) > in.size()) {
+        return false;
+    }
+    std::copy_n(in.data() + pos, sizeof(length), reinterpret_cast<char*>(&length));
+    pos += sizeof(length);
+    return true;
+}
+
+static void putField(std::string& out, const std::string& field) {
+    putLength(out, field.size());
+    out.append(field);
+}
+
+static bool getField(const std::string& in, size_t& pos, std::string& field) {
+    size_t start = pos;
+    uint32_t length = 0;
+    if (!getLength(in, start, length) || start + length > in.size()) {
+        return false;
+    }
+    field.assign(in, start, length);
+    pos = start + length;
+    return true;
+}
+
+static std::string encodeRecord(const PendingTranslation& item) {
+    std::string payload;
+    payload.reserve(item.byteSize());
+    putField(payload, item.originalText);
+    putField(payload, item.englishMeaning);
+    putField(payload, item.pinyinMandarin);
+    putField(payload, item.jyutpingCantonese);
+    putField(payload, item.equivalentCantonese);
+    putLength(payload, item.audio.size());
+    for (const auto& clip : item.audio) {
+        putField(payload, clip.voice);
+        putField(payload, clip.mimeType);
+        putField(payload, clip.data);
+    }
+
+    std::string record;
+    putField(record, payload);
+    return record;
+}
+
+static bool decodeRecord(const std::string& payload, PendingTranslation& item) {
+    size_t pos = 0;
+    uint32_t audioCount = 0;
+    if (!getField(payload, pos, item.originalText) ||
+        !getField(payload, pos, item.englishMeaning) ||
+        !getField(payload, pos, item.pinyinMandarin) ||
+        !getField(payload, pos, item.jyutpingCantonese) ||
+        !getField(payload, pos, item.equivalentCantonese) ||
+        !getLength(payload, pos, audioCount)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < audioCount; ++i) {
+        PendingAudio clip;
+        if (!getField(payload, pos, clip.voice) ||
+            !getField(payload, pos, clip.mimeType) ||
+            !getField(payload, pos, clip.data)) {
+            return false;
+        }
+        item.audio.push_back(std::move(clip));
+    }
+    return pos == payload.size();
+}
+
+WriteBehindQueue::WriteBehindQueue() : WriteBehindQueue(WriteBehindOptions()) {}
+
+WriteBehindQueue::WriteBehindQueue(const WriteBehindOptions& options)
+    : m_options(options),
+      m_queuedBytes(0),
+      m_inFlight(0),
+      m_running(false),
+      m_stopRequested(false),
+      m_journalBytes(0),
+      m_committed(0),
+      m_dropped(0),
+      m_failedBatches(0),
+      m_deadLettered(0) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Recover writes that were accepted but not committed before the last exit
+    if (!m_options.journalPath.empty()) {
+        size_t recovered = replayJournal();
+        if (recovered > 0) {
+            WRITER_LOG_INFO("Recovered {} pending writes from journal {}", recovered, m_options.journalPath);
+        }
+
+        // Rewrite the journal with only the recovered records so a torn tail
+        // from the crash can't swallow the records appended after it
+        truncateJournal();
+        for (const auto& item : m_queue) {
+            appendToJournal(item);
+        }
+    }
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    stop();
+}
+
+bool WriteBehindQueue::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+    m_stopRequested = false;
+    m_running = true;
+    m_worker = std::thread(&WriteBehindQueue::run, this);
+    WRITER_LOG_INFO("Write-behind queue started (batch={}, maxBytes={})",
+                    m_options.maxBatchSize, m_options.maxQueuedBytes);
+    return true;
+}
+
+void WriteBehindQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_stopRequested = true;
+    }
+    m_itemsAvailable.notify_all();
+    m_spaceAvailable.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    if (!m_queue.empty()) {
+        WRITER_LOG_WARNING("Write-behind queue stopped with {} unwritten items", m_queue.size());
+    }
+}
+
+bool WriteBehindQueue::enqueue(PendingTranslation item) {
+    size_t bytes = item.byteSize();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto hasSpace = [this, bytes]() {
+        return m_queuedBytes + bytes <= m_options.maxQueuedBytes;
+    };
+
+    if (!hasSpace() && m_options.overflowPolicy == WriteBehindOptions::OverflowPolicy::Block) {
+        m_spaceAvailable.wait_for(lock, m_options.blockTimeout,
+                                  [this, &hasSpace]() { return hasSpace() || m_stopRequested; });
+    }
+
+    if (!hasSpace()) {
+        m_dropped++;
+        WRITER_LOG_WARNING("Write-behind queue full ({} bytes queued), dropping write for text of {} bytes",
+                           m_queuedBytes, item.originalText.size());
+        return false;
+    }
+
+    appendToJournal(item);
+    m_queuedBytes += bytes;
+    m_queue.push_back(std::move(item));
+    lock.unlock();
+
+    m_itemsAvailable.notify_one();
+    return true;
+}
+
+bool WriteBehindQueue::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_drained.wait_for(lock, timeout, [this]() {
+        return m_queue.empty() && m_inFlight == 0;
+    });
+}
+
+size_t WriteBehindQueue::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size() + m_inFlight;
+}
+
+void WriteBehindQueue::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_itemsAvailable.wait(lock, [this]() { return m_stopRequested || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            break; // Stop requested and nothing left to write
+        }
+
+        // Give concurrent requests a moment to join this transaction
+        if (m_queue.size() < m_options.maxBatchSize && !m_stopRequested) {
+            m_itemsAvailable.wait_for(lock, m_options.flushInterval, [this]() {
+                return m_stopRequested || m_queue.size() >= m_options.maxBatchSize;
+            });
+        }
+
+        size_t count = std::min(m_queue.size(), m_options.maxBatchSize);
+        std::vector<PendingTranslation> batch(std::make_move_iterator(m_queue.begin()),
+                                              std::make_move_iterator(m_queue.begin() + count));
+        m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+        m_inFlight = count;
+        lock.unlock();
+
+        size_t failedItem = count;
+        bool success = writeBatch(batch, failedItem);
+
+        lock.lock();
+
+        if (success) {
+            m_inFlight = 0;
+            size_t batchBytes = 0;
+            for (const auto& item : batch) {
+                batchBytes += item.byteSize();
+            }
+            m_queuedBytes -= std::min(batchBytes, m_queuedBytes);
+            m_committed += count;
+            WRITER_LOG_DEBUG("Committed batch of {} translations", count);
+
+            // Everything journaled so far is now in MySQL. A queue that never
+            // drains gets its journal compacted instead.
+            if (m_queue.empty()) {
+                truncateJournal();
+                m_drained.notify_all();
+            } else if (m_journalBytes > m_options.journalCompactBytes &&
+                       m_journalBytes > 2 * m_queuedBytes) {
+                compactJournal(lock);
+            }
+            m_spaceAvailable.notify_all();
+            continue;
+        }
+
+        // An item that keeps failing on its own is set aside; the rest of
+        // its batch was fine and is retried right away
+        m_failedBatches++;
+        bool retryNow = false;
+        if (failedItem < batch.size() && ++batch[failedItem].attempts >= m_options.maxAttempts) {
+            PendingTranslation dead = std::move(batch[failedItem]);
+            batch.erase(batch.begin() + failedItem);
+            m_queuedBytes -= std::min(dead.byteSize(), m_queuedBytes);
+            lock.unlock();
+            deadLetter(dead);
+            lock.lock();
+            retryNow = true;
+        }
+
+        // Put the batch back in its original order and retry after a backoff
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            m_queue.push_front(std::move(*it));
+        }
+        m_inFlight = 0;
+        if (m_queue.empty()) {
+            truncateJournal();
+            m_drained.notify_all();
+        } else if (retryNow) {
+            // Drop the dead-lettered record so a restart doesn't replay it
+            compactJournal(lock);
+        }
+        m_spaceAvailable.notify_all();
+
+        if (m_stopRequested) {
+            // Leave the rest in the journal for the next start
+            break;
+        }
+        if (retryNow) {
+            continue;
+        }
+        WRITER_LOG_WARNING("Batch of {} translations failed, retrying in {} ms",
+                           count, m_options.retryInterval.count());
+        m_itemsAvailable.wait_for(lock, m_options.retryInterval, [this]() { return m_stopRequested; });
+    }
+
+    m_drained.notify_all();
+}
+
+bool WriteBehindQueue::writeBatch(const std::vector<PendingTranslation>& batch, size_t& failedItem) {
+    failedItem = batch.size();
+    if (!m_db.beginTransaction()) {
+        m_db.disconnect(); // Force a fresh session on the next attempt
+        return false;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const PendingTranslation& item = batch[i];
+        bool ok = m_db.storeTranslation(item.originalText,
+                                        item.englishMeaning,
+                                        item.pinyinMandarin,
+                                        item.jyutpingCantonese,
+                                        item.equivalentCantonese);
+
+        for (auto clip = item.audio.begin(); ok && clip != item.audio.end(); ++clip) {
+            int audioFileId = m_db.storeAudioData(clip->mimeType, clip->data);
+            ok = audioFileId > 0 && m_db.storeTranslationAudio(item.originalText, clip->voice, audioFileId);
+        }
+
+        if (!ok) {
+            WRITER_LOG_ERROR("Failed to write translation, rolling back batch of {}", batch.size());
+            m_db.rollbackTransaction();
+            m_db.disconnect();
+            // A lost connection fails every item; only blame this one if
+            // the session is still usable
+            if (m_db.connect()) {
+                failedItem = i;
+            }
+            return false;
+        }
+    }
+
+    if (!m_db.commitTransaction()) {
+        m_db.rollbackTransaction();
+        m_db.disconnect();
+        return false;
+    }
+    return true;
+}
+
+void WriteBehindQueue::deadLetter(const PendingTranslation& item) {
+    m_deadLettered++;
+    WRITER_LOG_ERROR("Giving up on translation of {} bytes after {} failed writes",
+                     item.originalText.size(), item.attempts);
+    if (m_options.deadLetterPath.empty()) {
+        return;
+    }
+
+    std::ofstream file(m_options.deadLetterPath, std::ios::binary | std::ios::app);
+    std::string record = encodeRecord(item);
+    if (!file.write(record.data(), record.size())) {
+        WRITER_LOG_ERROR("Could not write dead-letter file: {}", m_options.deadLetterPath);
+        return;
+    }
+    WRITER_LOG_WARNING("Dead-lettered translation saved to {}", m_options.deadLetterPath);
+}
+
+bool WriteBehindQueue::openJournal() {
+    m_journal.open(m_options.journalPath, std::ios::binary | std::ios::app);
+    if (!m_journal) {
+        WRITER_LOG_ERROR("Could not open write-behind journal: {}", m_options.journalPath);
+        return false;
+    }
+    return true;
+}
+
+void WriteBehindQueue::appendToJournal(const PendingTranslation& item) {
+    if (!m_journal.is_open()) {
+        return;
+    }
+
+    std::string record = encodeRecord(item);
+    m_journal.write(record.data(), record.size());
+    // Hand the record to the OS now so a process crash can't lose it
+    m_journal.flush();
+    m_journalBytes += record.size();
+}
+
+void WriteBehindQueue::truncateJournal() {
+    if (m_options.journalPath.empty()) {
+        return;
+    }
+
+    if (m_journal.is_open()) {
+        m_journal.close();
+    }
+    m_journal.open(m_options.journalPath, std::ios::binary | std::ios::trunc);
+    m_journal.close();
+    m_journalBytes = 0;
+    openJournal();
+}
+
+void WriteBehindQueue::compactJournal(std::unique_lock<std::mutex>& lock) {
+    if (m_options.journalPath.empty() || !m_journal.is_open()) {
+        return;
+    }
+
+    // Only this thread removes items, so the queue can only grow at the back
+    // while the lock is released below
+    std::string records;
+    for (const auto& item : m_queue) {
+        records += encodeRecord(item);
+    }
+    const size_t snapshotCount = m_queue.size();
+    const size_t oldBytes = m_journalBytes;
+    lock.unlock();
+
+    std::string compactPath = m_options.journalPath + ".compact";
+    std::ofstream compacted(compactPath, std::ios::binary | std::ios::trunc);
+    compacted.write(records.data(), records.size());
+    compacted.flush();
+
+    lock.lock();
+    // Items accepted meanwhile went to the old journal; copy them over
+    size_t bytes = records.size();
+    for (auto it = m_queue.begin() + snapshotCount; it != m_queue.end(); ++it) {
+        std::string record = encodeRecord(*it);
+        compacted.write(record.data(), record.size());
+        bytes += record.size();
+    }
+    compacted.close();
+    if (!compacted) {
+        std::remove(compactPath.c_str());
+        WRITER_LOG_WARNING("Could not compact write-behind journal {}", m_options.journalPath);
+        return;
+    }
+
+    m_journal.close();
+    if (std::rename(compactPath.c_str(), m_options.journalPath.c_str()) != 0) {
+        std::remove(compactPath.c_str());
+        WRITER_LOG_WARNING("Could not replace write-behind journal {}", m_options.journalPath);
+        openJournal();
+        return;
+    }
+    m_journalBytes = bytes;
+    openJournal();
+    WRITER_LOG_INFO("Compacted write-behind journal from {} to {} bytes", oldBytes, bytes);
+}
+
+size_t WriteBehindQueue::replayJournal() {
+    std::remove((m_options.journalPath + ".compact").c_str());  // Left by a crash mid-compaction
+
+    std::ifstream journal(m_options.journalPath, std::ios::binary);
+    if (!journal) {
+        return 0; // Nothing to recover
+    }
+
+    std::string contents((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+
+    size_t recovered = 0;
+    size_t pos = 0;
+    std::string payload;
+    while (getField(contents, pos, payload)) {
+        PendingTranslation item;
+        if (!decodeRecord(payload, item)) {
+            WRITER_LOG_WARNING("Skipping corrupt journal record at offset {}", pos);
+            continue;
+        }
+        m_queuedBytes += item.byteSize();
+        m_queue.push_back(std::move(item));
+        recovered++;
+    }
+
+    if (pos < contents.size()) {
+        WRITER_LOG_WARNING("Ignoring {} bytes of incomplete journal record", contents.size() - pos);
+    }
+    return recovered;
+}
@@ -1,4 +1,5 @@
 #include "../include/database.h"
+#include "../include/write_behind_queue.h"
 #include "test_utils.h"
 #include <gtest/gtest.h>
 #include <iostream>
@@ -123,7 +124,6 @@ TEST_F(DatabaseTest, TestTranslations) {
     std::string pinyinMandarin = "Nǐ hǎo";
     std::string jyutpingCantonese = "nei5 hou2";
     std::string equivalentCantonese = "你好";
-    int audioFileId = -1; // No audio initially
     
     // Test storing translation
     TEST_LOG_DEBUG("Storing translation: original={}, english={}", originalText, englishMeaning);
@@ -132,49 +132,31 @@ TEST_F(DatabaseTest, TestTranslations) {
         englishMeaning, 
         pinyinMandarin, 
         jyutpingCantonese, 
-        equivalentCantonese, 
-        audioFileId
+        equivalentCantonese
     ));
     
     // Test retrieving translation
-    std::string retrievedEnglish;
-    std::string retrievedPinyin;
-    std::string retrievedJyutping;
-    std::string retrievedCantonese;
-    int retrievedAudioId;
+    TranslationRecord retrieved;
     
     TEST_LOG_DEBUG("Retrieving translation for: {}", originalText);
-    ASSERT_TRUE(db.getTranslation(
-        originalText,
-        retrievedEnglish,
-        retrievedPinyin,
-        retrievedJyutping,
-        retrievedCantonese,
-        retrievedAudioId
-    ));
+    ASSERT_TRUE(db.getTranslation(originalText, retrieved));
+    
+    TEST_LOG_DEBUG("Retrieved: english={}, pinyin={}", retrieved.englishMeaning, retrieved.pinyinMandarin);
+    EXPECT_EQ(retrieved.originalText, originalText);
+    EXPECT_EQ(retrieved.englishMeaning, englishMeaning);
+    EXPECT_EQ(retrieved.pinyinMandarin, pinyinMandarin);
+    EXPECT_EQ(retrieved.jyutpingCantonese, jyutpingCantonese);
+    EXPECT_EQ(retrieved.equivalentCantonese, equivalentCantonese);
+    EXPECT_TRUE(retrieved.audioFileIds.empty()); // No audio initially
     
-    TEST_LOG_DEBUG("Retrieved: english={}, pinyin={}", retrievedEnglish, retrievedPinyin);
-    EXPECT_EQ(retrievedEnglish, englishMeaning);
-    EXPECT_EQ(retrievedPinyin, pinyinMandarin);
-    EXPECT_EQ(retrievedJyutping, jyutpingCantonese);
-    EXPECT_EQ(retrievedCantonese, equivalentCantonese);
-    EXPECT_EQ(retrievedAudioId, audioFileId);
+    // Surrounding whitespace maps to the same canonical row
+    TranslationRecord padded;
+    ASSERT_TRUE(db.getTranslation("  " + originalText + "\n", padded));
+    EXPECT_EQ(padded.englishMeaning, englishMeaning);
     
     // Test retrieving non-existent translation
-    std::string nonExistentEnglish;
-    std::string nonExistentPinyin;
-    std::string nonExistentJyutping;
-    std::string nonExistentCantonese;
-    int nonExistentAudioId;
-    
-    ASSERT_FALSE(db.getTranslation(
-        "不存在的文本",
-        nonExistentEnglish,
-        nonExistentPinyin,
-        nonExistentJyutping,
-        nonExistentCantonese,
-        nonExistentAudioId
-    ));
+    TranslationRecord nonExistent;
+    ASSERT_FALSE(db.getTranslation("不存在的文本", nonExistent));
     
     // Test updating existing translation
     std::string updatedEnglish = "Hello there";
@@ -186,30 +168,28 @@ TEST_F(DatabaseTest, TestTranslations) {
         updatedEnglish, 
         updatedPinyin, 
         jyutpingCantonese, 
-        equivalentCantonese, 
-        audioFileId
+        equivalentCantonese
     ));
     
     // Verify the update
-    std::string retrievedUpdatedEnglish;
-    std::string retrievedUpdatedPinyin;
-    std::string retrievedUpdatedJyutping;
-    std::string retrievedUpdatedCantonese;
-    int retrievedUpdatedAudioId;
+    TranslationRecord updated;
     
     TEST_LOG_DEBUG("Retrieving updated translation for: {}", originalText);
-    ASSERT_TRUE(db.getTranslation(
-        originalText,
-        retrievedUpdatedEnglish,
-        retrievedUpdatedPinyin,
-        retrievedUpdatedJyutping,
-        retrievedUpdatedCantonese,
-        retrievedUpdatedAudioId
-    ));
+    ASSERT_TRUE(db.getTranslation(originalText, updated));
     
-    TEST_LOG_DEBUG("Updated retrieved: english={}, pinyin={}", retrievedUpdatedEnglish, retrievedUpdatedPinyin);
-    EXPECT_EQ(retrievedUpdatedEnglish, updatedEnglish);
-    EXPECT_EQ(retrievedUpdatedPinyin, updatedPinyin);
+    TEST_LOG_DEBUG("Updated retrieved: english={}, pinyin={}", updated.englishMeaning, updated.pinyinMandarin);
+    EXPECT_EQ(updated.englishMeaning, updatedEnglish);
+    EXPECT_EQ(updated.pinyinMandarin, updatedPinyin);
+    
+    // Texts longer than the old VARCHAR(255) key are accepted
+    std::string longText;
+    for (int i = 0; i < 300; ++i) {
+        longText += "长";
+    }
+    ASSERT_TRUE(db.storeTranslation(longText, "long", "cháng", "coeng4", "長"));
+    TranslationRecord longRecord;
+    ASSERT_TRUE(db.getTranslation(longText, longRecord));
+    EXPECT_EQ(longRecord.originalText, longText);
     
     TEST_LOG_INFO("Translation operations test passed!");
 }
@@ -248,36 +228,33 @@ TEST_F(DatabaseTest, TestAudioFiles) {
     std::string jyutpingCantonese = "ze6 ze6";
     std::string equivalentCantonese = "唔該";
     
-    // Store translation with audio ID
-    TEST_LOG_DEBUG("Linking audio ID {} to translation", audioFileId);
     ASSERT_TRUE(db.storeTranslation(
         originalText,
         englishMeaning,
         pinyinMandarin,
         jyutpingCantonese,
-        equivalentCantonese,
-        audioFileId
+        equivalentCantonese
     ));
     
-    // Verify audio ID is correctly associated
-    std::string retrievedEnglish;
-    std::string retrievedPinyin;
-    std::string retrievedJyutping;
-    std::string retrievedCantonese;
-    int retrievedAudioId;
+    int cantoneseAudioId = db.storeAudioData(mimeType, "CANTONESE TEST AUDIO");
+    ASSERT_GT(cantoneseAudioId, 0);
     
-    TEST_LOG_DEBUG("Retrieving translation with audio link");
-    ASSERT_TRUE(db.getTranslation(
-        originalText,
-        retrievedEnglish,
-        retrievedPinyin,
-        retrievedJyutping,
-        retrievedCantonese,
-        retrievedAudioId
-    ));
+    // Link one clip per voice
+    TEST_LOG_DEBUG("Linking audio IDs {} and {} to translation", audioFileId, cantoneseAudioId);
+    ASSERT_TRUE(db.storeTranslationAudio(originalText, "mandarin", audioFileId));
+    ASSERT_TRUE(db.storeTranslationAudio(originalText, "cantonese", cantoneseAudioId));
+    
+    // Verify both audio IDs come back with the translation
+    TranslationRecord retrieved;
     
-    TEST_LOG_DEBUG("Checking audio ID link: expected={}, actual={}", audioFileId, retrievedAudioId);
-    EXPECT_EQ(retrievedAudioId, audioFileId);
+    TEST_LOG_DEBUG("Retrieving translation with audio links");
+    ASSERT_TRUE(db.getTranslation(originalText, retrieved));
+    EXPECT_EQ(retrieved.englishMeaning, englishMeaning);
+    
+    TEST_LOG_DEBUG("Checking audio ID links: count={}", retrieved.audioFileIds.size());
+    ASSERT_EQ(retrieved.audioFileIds.size(), 2u);
+    EXPECT_EQ(retrieved.audioFileIds["mandarin"], audioFileId);
+    EXPECT_EQ(retrieved.audioFileIds["cantonese"], cantoneseAudioId);
     
     // Clean up test file
     remove(audioFilePath.c_str());
@@ -285,6 +262,215 @@ TEST_F(DatabaseTest, TestAudioFiles) {
     TEST_LOG_INFO("Audio file operations test passed!");
 }
 
+TEST_F(DatabaseTest, TestAudioDataFromMemory) {
+    TEST_LOG_INFO("Testing in-memory audio storage...");
+    
+    // Binary payload with embedded NUL bytes to make sure nothing is truncated
+    static const char kAudioBytes[] = "ID3\0\x01\x02MEMORY AUDIO\0\xff";
+    static const char kOtherAudioBytes[] = "ID3\0\x03\x04OTHER AUDIO";
+    std::string audioData(kAudioBytes, sizeof(kAudioBytes) - 1);
+    std::string otherAudioData(kOtherAudioBytes, sizeof(kOtherAudioBytes) - 1);
+    std::string mimeType = "audio/mpeg";
+    
+    int firstId = db.storeAudioData(mimeType, audioData);
+    ASSERT_GT(firstId, 0);
+    
+    // A different clip gets its own ID straight from the insert result
+    int secondId = db.storeAudioData(mimeType, otherAudioData);
+    ASSERT_GT(secondId, firstId);
+    
+    // Identical content is deduplicated by content hash and mime type
+    EXPECT_EQ(db.storeAudioData(mimeType, audioData), firstId);
+    
+    // The same bytes under another type must not hand back the first row
+    int wavId = db.storeAudioData("audio/wav", audioData);
+    ASSERT_GT(wavId, secondId);
+    std::string wavMimeType;
+    std::string wavAudioData;
+    ASSERT_TRUE(db.getAudioData(wavId, wavMimeType, wavAudioData));
+    EXPECT_EQ(wavMimeType, "audio/wav");
+    EXPECT_EQ(wavAudioData, audioData);
+    
+    std::string retrievedMimeType;
+    std::string retrievedAudioData;
+    ASSERT_TRUE(db.getAudioData(firstId, retrievedMimeType, retrievedAudioData));
+    EXPECT_EQ(retrievedMimeType, mimeType);
+    EXPECT_EQ(retrievedAudioData, audioData);
+    
+    TEST_LOG_INFO("In-memory audio storage test passed!");
+}
+
+TEST_F(DatabaseTest, TestAsyncOperations) {
+    TEST_LOG_INFO("Testing async database operations...");
+    
+    // Async calls run on executor sessions outside the fixture's transaction
+    Database asyncDb;
+    asyncDb.setAsyncPoolSize(2);
+    
+    std::future<int> audioFuture = asyncDb.storeAudioDataAsync("audio/mpeg", "ASYNC TEST AUDIO");
+    int audioFileId = audioFuture.get();
+    ASSERT_GT(audioFileId, 0);
+    
+    TranslationRecord record;
+    record.originalText = "早上好";
+    record.englishMeaning = "Good morning";
+    record.pinyinMandarin = "Zǎoshang hǎo";
+    record.jyutpingCantonese = "zou2 san4";
+    record.equivalentCantonese = "早晨";
+    record.audioFileIds["mandarin"] = audioFileId;
+    ASSERT_TRUE(asyncDb.storeTranslationAsync(record).get());
+    
+    // Issue both reads before waiting on either
+    auto translationFuture = asyncDb.getTranslationAsync(record.originalText);
+    auto missingFuture = asyncDb.getTranslationAsync("从未见过的文本");
+    
+    std::optional<TranslationRecord> retrieved = translationFuture.get();
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->englishMeaning, record.englishMeaning);
+    EXPECT_EQ(retrieved->audioFileIds["mandarin"], audioFileId);
+    EXPECT_FALSE(missingFuture.get().has_value());
+    
+    std::optional<AudioRecord> audio = asyncDb.getAudioDataAsync(audioFileId).get();
+    ASSERT_TRUE(audio.has_value());
+    EXPECT_EQ(audio->data, "ASYNC TEST AUDIO");
+    
+    TEST_LOG_INFO("Async database operations test passed!");
+}
+
+TEST_F(DatabaseTest, TestTranslationFilter) {
+    TEST_LOG_INFO("Testing translation Bloom filter...");
+    
+    ASSERT_TRUE(db.storeTranslation("过滤器测试", "filter test", "guò lǜ qì cè shì",
+                                    "gwo3 leoi6 hei3 caak1 si3", "過濾器測試"));
+    
+    // Rebuild the filter from the table, as the server does at startup
+    auto filter = std::make_shared<BloomFilter>(1024);
+    ASSERT_GE(db.loadTranslationKeys(*filter), 1);
+    EXPECT_TRUE(filter->mightContain(Database::textHash("过滤器测试")));
+    
+    Database::setTranslationFilter(filter);
+    EXPECT_TRUE(Database::mightHaveTranslation("  过滤器测试  "));
+    
+    // A definite miss is answered without a query
+    TranslationRecord record;
+    EXPECT_FALSE(Database::mightHaveTranslation("从未见过的文本"));
+    EXPECT_FALSE(db.getTranslation("从未见过的文本", record));
+    
+    // New translations become visible through the filter immediately
+    ASSERT_TRUE(db.storeTranslation("新的文本", "new text", "xīn de wén běn",
+                                    "san1 dik1 man4 bun2", "新嘅文本"));
+    EXPECT_TRUE(Database::mightHaveTranslation("新的文本"));
+    EXPECT_TRUE(db.getTranslation("新的文本", record));
+    
+    // Snapshots round-trip only into a filter of the same size
+    std::string snapshotPath = "/tmp/hansnap_filter_test.bin";
+    ASSERT_TRUE(filter->saveSnapshot(snapshotPath));
+    BloomFilter restored(1024);
+    ASSERT_TRUE(restored.loadSnapshot(snapshotPath));
+    EXPECT_TRUE(restored.mightContain(Database::textHash("新的文本")));
+    BloomFilter resized(4096);
+    EXPECT_FALSE(resized.loadSnapshot(snapshotPath));
+    std::remove(snapshotPath.c_str());
+    
+    Database::setTranslationFilter(nullptr);
+    TEST_LOG_INFO("Translation Bloom filter test passed!");
+}
+
+TEST_F(DatabaseTest, TestWriteBehindQueueRecoversJournal) {
+    TEST_LOG_INFO("Testing write-behind queue journal recovery...");
+    
+    WriteBehindOptions options;
+    options.journalPath = "/tmp/hansnap_test_writes.journal";
+    remove(options.journalPath.c_str());
+    
+    PendingTranslation pending;
+    pending.originalText = "再见";
+    pending.englishMeaning = "Goodbye";
+    pending.pinyinMandarin = "Zàijiàn";
+    pending.jyutpingCantonese = "zoi3 gin3";
+    pending.equivalentCantonese = "拜拜";
+    pending.audio.push_back({"mandarin", "audio/mpeg", "WRITE BEHIND MANDARIN"});
+    pending.audio.push_back({"cantonese", "audio/mpeg", "WRITE BEHIND CANTONESE"});
+    
+    // Accept a write but never start the writer, as if the process crashed
+    {
+        WriteBehindQueue crashed(options);
+        ASSERT_TRUE(crashed.enqueue(pending));
+    }
+    
+    // A new queue replays the journal and commits it
+    {
+        WriteBehindQueue recovered(options);
+        EXPECT_EQ(recovered.pendingCount(), 1u);
+        ASSERT_TRUE(recovered.start());
+        ASSERT_TRUE(recovered.flush());
+        EXPECT_EQ(recovered.committedCount(), 1u);
+    }
+    
+    TranslationRecord record;
+    ASSERT_TRUE(db.getTranslation(pending.originalText, record));
+    EXPECT_EQ(record.englishMeaning, pending.englishMeaning);
+    EXPECT_EQ(record.audioFileIds.size(), 2u);
+    
+    // Fully drained, so nothing is replayed again
+    WriteBehindQueue drained(options);
+    EXPECT_EQ(drained.pendingCount(), 0u);
+    
+    remove(options.journalPath.c_str());
+    TEST_LOG_INFO("Write-behind queue test passed!");
+}
+
+TEST_F(DatabaseTest, TestWriteBehindQueueDeadLettersPoisonRecord) {
+    TEST_LOG_INFO("Testing write-behind queue dead-lettering...");
+    
+    WriteBehindOptions options;
+    options.journalPath = "/tmp/hansnap_test_poison.journal";
+    options.deadLetterPath = "/tmp/hansnap_test_poison.journal.dead";
+    options.retryInterval = std::chrono::milliseconds(10);
+    options.maxAttempts = 2;
+    remove(options.journalPath.c_str());
+    remove(options.deadLetterPath.c_str());
+    
+    // Longer than english_meaning allows, so this item fails on every attempt
+    PendingTranslation poison;
+    poison.originalText = "毒";
+    poison.englishMeaning = std::string(600, 'x');
+    poison.pinyinMandarin = "Dú";
+    poison.jyutpingCantonese = "duk6";
+    poison.equivalentCantonese = "毒";
+    
+    PendingTranslation good;
+    good.originalText = "早晨";
+    good.englishMeaning = "Good morning";
+    good.pinyinMandarin = "Zǎochén";
+    good.jyutpingCantonese = "zou2 san4";
+    good.equivalentCantonese = "早晨";
+    
+    {
+        WriteBehindQueue queue(options);
+        ASSERT_TRUE(queue.enqueue(poison));
+        ASSERT_TRUE(queue.enqueue(good));
+        ASSERT_TRUE(queue.start());
+        ASSERT_TRUE(queue.flush());
+        EXPECT_EQ(queue.committedCount(), 1u);
+        EXPECT_EQ(queue.deadLetteredCount(), 1u);
+        EXPECT_EQ(queue.pendingCount(), 0u);
+    }
+    
+    TranslationRecord record;
+    EXPECT_TRUE(db.getTranslation(good.originalText, record));
+    EXPECT_FALSE(db.getTranslation(poison.originalText, record));
+    
+    // The poison record is kept for inspection
+    std::ifstream deadLetters(options.deadLetterPath, std::ios::binary | std::ios::ate);
+    ASSERT_TRUE(deadLetters.is_open());
+    EXPECT_GT(deadLetters.tellg(), 0);
+    
+    remove(options.journalPath.c_str());
+    remove(options.deadLetterPath.c_str());
+    TEST_LOG_INFO("Write-behind dead-letter test passed!");
+}
+
 // Add this to customize main if needed
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
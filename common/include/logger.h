@@ -1,11 +1,18 @@
 #pragma once
 #include <iostream>
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/dist_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
 
 namespace hansnap {
 
@@ -21,11 +28,66 @@ public:
         OFF = spdlog::level::off
     };
 
+    // What an async logger does when its queue is full
+    enum class OverflowPolicy {
+        Block,      // Wait for the writer thread (never loses messages)
+        DropOldest  // Overwrite the oldest queued message (never blocks the caller)
+    };
+
+    struct AsyncOptions {
+        size_t queueSize = 8192;   // Messages buffered before the overflow policy applies
+        size_t threadCount = 1;    // Background threads writing to the sinks
+        OverflowPolicy overflowPolicy = OverflowPolicy::DropOldest;
+    };
+
+    // How logPayload() renders large request/response bodies
+    struct PayloadOptions {
+        size_t maxBytes = 512;     // Prefix of the payload kept in the log line
+        bool includeHash = false;  // Append an FNV-1a hash of the full payload
+        size_t sampleEvery = 1;    // Log 1 in N payloads per logger (1 logs all)
+    };
+
+    // Per-logger payload counters
+    struct PayloadStats {
+        uint64_t logged = 0;        // Payloads written to the log
+        uint64_t sampledOut = 0;    // Payloads skipped by sampling
+        uint64_t payloadBytes = 0;  // Total size of all payloads seen
+        uint64_t loggedBytes = 0;   // Payload bytes actually written
+    };
+
+    // Live counters behind PayloadStats, one set per logger name
+    struct PayloadCounters {
+        std::atomic<uint64_t> seen{0};
+        std::atomic<uint64_t> logged{0};
+        std::atomic<uint64_t> sampledOut{0};
+        std::atomic<uint64_t> payloadBytes{0};
+        std::atomic<uint64_t> loggedBytes{0};
+    };
+
     static Logger& getInstance() {
         static Logger instance;
         return instance;
     }
 
+    /**
+     * Hand formatted messages to background threads so callers never wait on
+     * console or disk I/O. Must be called before initialize().
+     *
+     * @return false if the logger was already initialized
+     */
+    bool enableAsync() { return enableAsync(AsyncOptions()); }
+    bool enableAsync(const AsyncOptions& options) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        if (m_initialized) return false;
+        
+        m_async = true;
+        m_asyncOptions = options;
+        return true;
+    }
+
+    bool isAsync() const { return m_async; }
+
     // Initialize with default console logger
     void initialize(const std::string& appName = "hansnap") {
         std::lock_guard<std::mutex> lock(m_mutex);
@@ -33,22 +95,25 @@ public:
         if (m_initialized) return;
         
         try {
-            // Create console sink
-            auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+            // All loggers write through one distributing sink, so sinks added
+            // later (e.g. the file sink) reach every component logger and can
+            // be added while a writer thread is logging
+            m_sinks = std::make_shared<spdlog::sinks::dist_sink_mt>();
+            m_sinks->add_sink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
             
-            // Create default logger with console sink
-            m_logger = std::make_shared<spdlog::logger>(appName, console_sink);
+            // Create default logger
+            m_logger = makeLogger(appName);
             
             // Set global default logger
             spdlog::set_default_logger(m_logger);
             
             // Set pattern: [timestamp] [level] [logger] message
-            spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%n] %v");
+            spdlog::set_pattern(PATTERN);
             
             // Set default level
             spdlog::set_level(spdlog::level::info);
             
-            m_initialized = true;
+            m_initialized.store(true, std::memory_order_release);
             
             // Don't log inside the locked section to avoid recursive lock
             // m_logger->info("Logger initialized");
@@ -67,35 +132,20 @@ public:
     bool addFileLogger(const std::string& filename, 
                        size_t maxFileSize = 5 * 1024 * 1024,    // 5MB
                        size_t maxFiles = 3) {
-        std::shared_ptr<spdlog::logger> logger_copy;
-        
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            
-            if (!m_initialized) {
-                // Just set the flag, call initialize() outside the lock
-                m_initialized = false;
-            }
-            
-            // Store a copy of the logger pointer to use outside the lock
-            logger_copy = m_logger;
-        }
-        
-        // Initialize outside the lock if needed
-        if (!m_initialized) {
+        // Initialize first if needed; the logger and sink never change afterwards
+        if (!m_initialized.load(std::memory_order_acquire)) {
             initialize();
         }
+        std::shared_ptr<spdlog::logger> logger_copy = m_logger;
         
         try {
             // Create rotating file sink (5MB max size, 3 rotated files)
             auto file_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
                 filename, maxFileSize, maxFiles);
+            file_sink->set_pattern(PATTERN);
             
-            {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                // Add the file sink to the logger
-                m_logger->sinks().push_back(file_sink);
-            }
+            // The distributing sink locks internally, so no need for m_mutex
+            m_sinks->add_sink(file_sink);
             
             // Log outside the lock
             if (logger_copy) {
@@ -141,18 +191,92 @@ public:
         }
     }
 
-    // Get the logger - FIXED VERSION
+    // Get the logger. m_logger never changes once initialized, so the
+    // common path is a single atomic load with no lock.
     std::shared_ptr<spdlog::logger> getLogger() {
-        // First check outside lock to avoid locking if possible
-        if (!m_initialized) {
+        if (!m_initialized.load(std::memory_order_acquire)) {
             initialize();
         }
         
-        // Now just obtain the logger under lock
-        std::lock_guard<std::mutex> lock(m_mutex);
         return m_logger;
     }
 
+    void setPayloadOptions(const PayloadOptions& options) {
+        m_payloadMaxBytes.store(options.maxBytes);
+        m_payloadHash.store(options.includeHash);
+        m_payloadSampleEvery.store(options.sampleEvery > 0 ? options.sampleEvery : 1);
+    }
+
+    /**
+     * Log a potentially large payload with bounded size. Only a prefix of the
+     * payload is formatted (cut on a UTF-8 boundary), followed by its full
+     * size and optionally a hash, so the cost of a log line does not grow
+     * with the payload. Use HANSNAP_LOG_PAYLOAD so the payload expression is
+     * only evaluated when the level is enabled.
+     */
+    void logPayload(const std::shared_ptr<spdlog::logger>& logger, Level level,
+                    std::string_view label, std::string_view payload) {
+        auto lvl = static_cast<spdlog::level::level_enum>(level);
+        if (!logger || !logger->should_log(lvl)) return;
+        logPayload(logger, payloadCounters(logger->name()), level, label, payload);
+    }
+
+    // Same, with the logger's counters already looked up (no lock)
+    void logPayload(const std::shared_ptr<spdlog::logger>& logger, PayloadCounters& counters,
+                    Level level, std::string_view label, std::string_view payload) {
+        auto lvl = static_cast<spdlog::level::level_enum>(level);
+        if (!logger || !logger->should_log(lvl)) return;
+        
+        counters.payloadBytes.fetch_add(payload.size(), std::memory_order_relaxed);
+        
+        size_t sampleEvery = m_payloadSampleEvery.load(std::memory_order_relaxed);
+        if (counters.seen.fetch_add(1, std::memory_order_relaxed) % sampleEvery != 0) {
+            counters.sampledOut.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        // Back up to the start of a UTF-8 sequence so the prefix stays valid
+        size_t keep = std::min(payload.size(), m_payloadMaxBytes.load(std::memory_order_relaxed));
+        while (keep > 0 && keep < payload.size() &&
+               (static_cast<unsigned char>(payload[keep]) & 0xC0) == 0x80) {
+            --keep;
+        }
+        std::string_view prefix = payload.substr(0, keep);
+        size_t omitted = payload.size() - keep;
+        
+        counters.logged.fetch_add(1, std::memory_order_relaxed);
+        counters.loggedBytes.fetch_add(keep, std::memory_order_relaxed);
+        
+        if (m_payloadHash.load(std::memory_order_relaxed)) {
+            logger->log(lvl, "{} ({} bytes, fnv1a={:016x}): {}{}", label, payload.size(),
+                        fnv1a(payload), prefix, omitted ? "... [truncated]" : "");
+        } else {
+            logger->log(lvl, "{} ({} bytes): {}{}", label, payload.size(),
+                        prefix, omitted ? "... [truncated]" : "");
+        }
+    }
+
+    // Counters are created once per logger name and never removed, so the
+    // reference stays valid. Takes a lock: look them up once per logger.
+    PayloadCounters& payloadCounters(const std::string& loggerName) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        std::unique_ptr<PayloadCounters>& counters = m_payloadCounters[loggerName];
+        if (!counters) {
+            counters = std::make_unique<PayloadCounters>();
+        }
+        return *counters;
+    }
+
+    PayloadStats getPayloadStats(const std::string& loggerName) {
+        PayloadCounters& counters = payloadCounters(loggerName);
+        PayloadStats stats;
+        stats.logged = counters.logged.load();
+        stats.sampledOut = counters.sampledOut.load();
+        stats.payloadBytes = counters.payloadBytes.load();
+        stats.loggedBytes = counters.loggedBytes.load();
+        return stats;
+    }
+
     // Create a new named logger (for components) - FIXED VERSION
     std::shared_ptr<spdlog::logger> createLogger(const std::string& name) {
         // First check if initialized outside lock
@@ -176,8 +300,7 @@ public:
         }
         
         // Create the new logger
-        auto new_logger = std::make_shared<spdlog::logger>(name, m_logger->sinks().begin(), 
-                                                          m_logger->sinks().end());
+        auto new_logger = makeLogger(name);
         new_logger->set_level(m_logger->level());
         spdlog::register_logger(new_logger);
         
@@ -185,7 +308,38 @@ public:
     }
 
 private:
-    Logger() : m_initialized(false) {}
+    static uint64_t fnv1a(std::string_view data) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static constexpr const char* PATTERN = "[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%n] %v";
+
+    // Create a logger on the shared sink, async if enabled (call with m_mutex held)
+    std::shared_ptr<spdlog::logger> makeLogger(const std::string& name) {
+        if (!m_async) {
+            return std::make_shared<spdlog::logger>(name, m_sinks);
+        }
+        
+        if (!m_threadPool) {
+            m_threadPool = std::make_shared<spdlog::details::thread_pool>(
+                m_asyncOptions.queueSize, m_asyncOptions.threadCount);
+        }
+        
+        auto policy = m_asyncOptions.overflowPolicy == OverflowPolicy::Block
+            ? spdlog::async_overflow_policy::block
+            : spdlog::async_overflow_policy::overrun_oldest;
+        return std::make_shared<spdlog::async_logger>(name, m_sinks, m_threadPool, policy);
+    }
+
+    Logger() : m_initialized(false), m_async(false),
+               m_payloadMaxBytes(PayloadOptions().maxBytes),
+               m_payloadHash(PayloadOptions().includeHash),
+               m_payloadSampleEvery(PayloadOptions().sampleEvery) {}
     ~Logger() {
         try {
             // Only call shutdown if we initialized
@@ -202,9 +356,19 @@ private:
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    bool m_initialized;
+    std::atomic<bool> m_initialized;
+    bool m_async;
+    AsyncOptions m_asyncOptions;
+    std::shared_ptr<spdlog::sinks::dist_sink_mt> m_sinks;
+    std::shared_ptr<spdlog::details::thread_pool> m_threadPool;
     std::shared_ptr<spdlog::logger> m_logger;
     std::mutex m_mutex;
+    
+    std::atomic<size_t> m_payloadMaxBytes;
+    std::atomic<bool> m_payloadHash;
+    std::atomic<size_t> m_payloadSampleEvery;
+    std::unordered_map<std::string, std::unique_ptr<PayloadCounters>> m_payloadCounters;
+    std::mutex m_statsMutex;
 };
 
 // Use prefixed macro names instead of generic ones
@@ -215,4 +379,18 @@ private:
 #define HANSNAP_LOG_ERROR(...) SPDLOG_ERROR(__VA_ARGS__)
 #define HANSNAP_LOG_CRITICAL(...) SPDLOG_CRITICAL(__VA_ARGS__)
 
+// Bounded payload logging; `payload` is only evaluated if `lvl` is enabled.
+// Each call site looks up its logger's counters on first use and keeps them,
+// so `logger` must name the same logger every time (e.g. a module's getter).
+#define HANSNAP_LOG_PAYLOAD(logger, lvl, label, payload) \
+    do { \
+        const auto& hansnapPayloadLogger = (logger); \
+        if (hansnapPayloadLogger->should_log(static_cast<spdlog::level::level_enum>(lvl))) { \
+            static ::hansnap::Logger::PayloadCounters& hansnapPayloadCounters = \
+                ::hansnap::Logger::getInstance().payloadCounters(hansnapPayloadLogger->name()); \
+            ::hansnap::Logger::getInstance().logPayload(hansnapPayloadLogger, hansnapPayloadCounters, \
+                                                        (lvl), (label), (payload)); \
+        } \
+    } while (0)
+
 } // namespace hansnap 
\ No newline at end of file
@@ -8,10 +8,19 @@
 #include <functional>
 #include <string>
 #include <memory>
+#include <atomic>
+#include "pixel_buffer.h"
 
 // Forward declaration
 struct ClipboardData;
 
+// Counts of clipboard changes handed to the callbacks versus dropped because
+// newer content replaced them within the settle window
+struct ClipboardDispatchStats {
+    uint64_t dispatched = 0;
+    uint64_t suppressed = 0;
+};
+
 class ClipboardProcessor : public wxTimer
 {
 public:
@@ -19,11 +28,14 @@ public:
     virtual ~ClipboardProcessor();
 
     // Initialize the processor with optional callbacks for different data types
-    // Now including timestamps in callbacks
+    // Now including timestamps in callbacks. Images arrive as pixels read
+    // once from the clipboard, which the callback may keep and share.
     bool Initialize(std::function<void(const wxString&, const wxDateTime&)> textCallback = nullptr,
-                   std::function<void(const wxBitmap&, const wxDateTime&)> imageCallback = nullptr);
+                   std::function<void(const PixelBuffer&, const wxDateTime&)> imageCallback = nullptr);
     
-    // Start monitoring the clipboard
+    // Start monitoring the clipboard. Where the platform can report clipboard
+    // changes (XFixes on X11) the clipboard is only read when it changes;
+    // otherwise it is polled every checkIntervalMs.
     bool Start(int checkIntervalMs = 500);
     
     // Stop monitoring the clipboard
@@ -32,14 +44,33 @@ public:
     // Check clipboard content (can be called manually)
     bool ProcessClipboard();
     
+    // True if changes are reported by the platform instead of polled
+    bool IsEventDriven() const;
+    
+    // Changes that follow each other within settleMs are treated as one
+    // burst: only the last one reaches the callbacks, once the clipboard has
+    // been quiet for settleMs. 0 dispatches every change immediately.
+    void SetSettleInterval(int settleMs);
+    int GetSettleInterval() const;
+    
+    ClipboardDispatchStats GetDispatchStats() const;
+    
     // Timestamp accessors
     wxDateTime GetCurrentTimestamp() const;
     std::shared_ptr<ClipboardData> GetCurrentClipboardData() const;
     wxString GetTimestampString() const;
 
 private:
+    class ChangeWatcher;
+    struct PendingChange;
+    
     // wxTimer notification override
     void Notify() override;
+    
+    // Burst handling: hold a change until the settle window passes
+    void QueueChange(std::unique_ptr<PendingChange> change);
+    void DispatchPending();
+    void OnSettleTimer(wxTimerEvent& event);
 
     // Format detection methods
     void LogAvailableFormats();
@@ -62,8 +93,8 @@ private:
     // bool ProcessTiffFormat();
     // bool TryImageFromMemoryStream(const void* data, size_t len, wxBitmapType type = wxBITMAP_TYPE_PNG);
     // bool TryImageFromTempFile(const void* data, size_t len, const wxString& extension);
-    bool GetPngImage(wxBitmap& bitmap);
-    bool GetTiffImage(wxBitmap& bitmap);
+    bool GetPngImage(PixelBuffer& pixels);
+    bool GetTiffImage(PixelBuffer& pixels);
     #endif
     
     bool TryGetImageFromClipboard(wxBitmap& bitmap);
@@ -71,9 +102,19 @@ private:
     // Member variables
     wxString m_lastClipboardContent;
     std::function<void(const wxString&, const wxDateTime&)> m_textCallback;
-    std::function<void(const wxBitmap&, const wxDateTime&)> m_imageCallback;
+    std::function<void(const PixelBuffer&, const wxDateTime&)> m_imageCallback;
     bool m_initialized;
     std::shared_ptr<ClipboardData> m_clipboardData;
+    std::unique_ptr<ChangeWatcher> m_watcher;
+    std::atomic<bool> m_changePending;
+    
+    // Newest change not yet dispatched, waiting for m_settleTimer
+    std::unique_ptr<PendingChange> m_pendingChange;
+    wxTimer m_settleTimer;
+    int m_settleMs;
+    wxString m_lastDispatchedText;
+    uint64_t m_lastDispatchedImageHash;
+    ClipboardDispatchStats m_stats;
 };
 
 #endif // CLIPBOARD_PROCESSOR_H
@@ -1,30 +1,112 @@
 #pragma once
 
 #include <wx/string.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
 
 /**
- * Simple HTTP client utility using libcurl
+ * Result of an HTTP request
+ */
+struct HttpResponse {
+    long statusCode = 0;   // HTTP status, 0 if no response was received
+    std::string body;      // Raw response bytes
+    std::string error;     // Transport error, empty on success
+    bool cancelled = false;
+
+    bool Ok() const { return error.empty() && statusCode >= 200 && statusCode < 300; }
+};
+
+/**
+ * HTTP client using libcurl.
+ *
+ * Each instance runs one background thread driving a curl multi handle, so
+ * requests never block the caller and connections (and easy handles) are
+ * reused across requests to the same server. Request and response bodies are
+ * plain byte strings and are moved rather than copied.
+ *
+ * The static Get/Post helpers are blocking wrappers around a shared instance,
+ * kept for simple callers.
  */
 class HttpClient {
 public:
+    static constexpr std::chrono::milliseconds DEFAULT_TIMEOUT{60000};
+
+    HttpClient();
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    /**
+     * Start a GET request
+     *
+     * @param url The complete URL (e.g., "http://localhost:8080/health")
+     * @param timeout Limit for the whole request
+     * @param cancel Optional flag; setting it aborts the request. Must stay
+     *               valid until the returned future is ready.
+     * @return Future for the response
+     */
+    std::future<HttpResponse> GetAsync(std::string url,
+                                       std::chrono::milliseconds timeout = DEFAULT_TIMEOUT,
+                                       const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * Start a POST request
+     *
+     * @param url The complete URL
+     * @param body Request body, moved into the request
+     * @param contentType Value of the Content-Type header
+     * @param timeout Limit for the whole request
+     * @param cancel Optional flag; setting it aborts the request. Must stay
+     *               valid until the returned future is ready.
+     * @return Future for the response
+     */
+    std::future<HttpResponse> PostAsync(std::string url, std::string body,
+                                        const std::string& contentType = "application/json",
+                                        std::chrono::milliseconds timeout = DEFAULT_TIMEOUT,
+                                        const std::atomic<bool>* cancel = nullptr);
+
     /**
-     * Sends a GET request to a URL
-     * 
+     * Send later requests over a Unix domain socket instead of TCP. The URL
+     * still supplies the scheme, Host header and path. An empty path
+     * switches back to TCP.
+     */
+    void SetUnixSocketPath(const std::string& path);
+
+    // Client shared by the whole application
+    static HttpClient& Shared();
+
+    /**
+     * Sends a GET request to a URL and waits for the response
+     *
      * @param url The complete URL to send request to (e.g., "http://localhost:8080/api/data")
      * @return Response text or error message
      */
     static wxString Get(const wxString& url);
-    
+
     /**
-     * Sends a POST request with JSON data
-     * 
+     * Sends a POST request with JSON data and waits for the response
+     *
      * @param url The complete URL to send request to
      * @param jsonData The JSON data to send in the request body
      * @return Response text or error message
      */
     static wxString Post(const wxString& url, const wxString& jsonData);
-    
+
+    /**
+     * Sends a POST request that can be abandoned from another thread
+     *
+     * @param url The complete URL to send request to
+     * @param jsonData The JSON data to send in the request body
+     * @param cancel Flag polled during the transfer; setting it aborts the request
+     * @return Response text or error message
+     */
+    static wxString Post(const wxString& url, const wxString& jsonData, const std::atomic<bool>* cancel);
+
 private:
-    // Helper function used to accumulate response data
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
-}; 
\ No newline at end of file
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
@@ -0,0 +1,74 @@
+#ifndef IMAGE_HASH_H
+#define IMAGE_HASH_H
+
+#include <wx/image.h>
+#include <cstddef>
+#include <cstdint>
+#include "pixel_buffer.h"
+
+/**
+ * Hash a block of memory with a 64-bit XXH64-compatible hash.
+ *
+ * The main loop consumes 32 bytes per iteration in four independent lanes,
+ * so it runs close to memory bandwidth on large pixel buffers.
+ *
+ * @param data Bytes to hash
+ * @param length Number of bytes
+ * @param seed Seed, e.g. a previous hash to chain several buffers
+ * @return 64-bit hash
+ */
+uint64_t HashBytes(const void* data, size_t length, uint64_t seed = 0);
+
+/**
+ * Hash the raw pixels of an image (RGB plus alpha, if any) and its size.
+ *
+ * Two images hash equal only if they have the same dimensions and, with
+ * overwhelming probability, identical pixels.
+ *
+ * @param image The image to hash
+ * @return 64-bit hash, or 0 for an invalid image
+ */
+uint64_t HashImagePixels(const wxImage& image);
+uint64_t HashImagePixels(const PixelBuffer& pixels);
+
+/**
+ * Difference hash (dHash) of an image's content, for finding near-duplicates.
+ *
+ * Uniform rows and columns at the edges (margins, a one-color frame) are
+ * trimmed first, so re-captures of the same area with slightly different
+ * borders hash alike. The content is averaged into a 17x16 grid, and each bit
+ * records whether a cell is darker than its right neighbour. The trimmed
+ * pixels are also hashed exactly, to tell a re-capture from an image that
+ * merely looks alike.
+ */
+struct PerceptualHash {
+    uint64_t bits[4] = {0, 0, 0, 0};
+    uint64_t content = 0;  // HashBytes of the trimmed RGB pixels
+    int width = 0;   // Size of the trimmed content; 0 if the image is blank
+    int height = 0;
+
+    bool IsValid() const { return width > 0 && height > 0; }
+};
+
+/**
+ * Compute the perceptual hash of packed RGB pixels.
+ *
+ * @param rgb Pixels, 3 bytes each, rows stored contiguously
+ * @param width Image width
+ * @param height Image height
+ * @return The hash; invalid if the image has no content
+ */
+PerceptualHash ComputePerceptualHash(const unsigned char* rgb, int width, int height);
+
+/**
+ * Compute the perceptual hash of an image (alpha is ignored).
+ */
+PerceptualHash ComputePerceptualHash(const wxImage& image);
+PerceptualHash ComputePerceptualHash(const PixelBuffer& pixels);
+
+/**
+ * Number of differing bits between two perceptual hashes (0-256).
+ */
+int HammingDistance(const PerceptualHash& a, const PerceptualHash& b);
+
+#endif // IMAGE_HASH_H
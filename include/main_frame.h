@@ -3,9 +3,15 @@
 #include <wx/wx.h>
 #include <wx/filename.h>
 #include <wx/datetime.h>
+#include <wx/timer.h>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <thread>
 #include "clipboard_processor.h"
+#include "http_client.h"
 #include "taskbar.h"
+#include "translation_pipeline.h"
 #include <nlohmann/json.hpp>
 
 // MainFrame class that listens for clipboard events.
@@ -23,11 +29,14 @@ private:
     void OnClipboardText(const wxString& text, const wxDateTime& timestamp);
     
     // Event handler for clipboard images - includes timestamp
-    void OnClipboardImage(const wxBitmap& image, const wxDateTime& timestamp);
+    void OnClipboardImage(const PixelBuffer& image, const wxDateTime& timestamp);
     
     // Handle window close event
     void OnClose(wxCloseEvent& event);
 
+    // Called on the UI thread when the newest translation job finishes
+    void OnTranslationResult(const TranslationResult& result);
+
     // Method to update UI with translation data
     void UpdateUIWithTranslation(const nlohmann::json& response);
     
@@ -43,6 +52,13 @@ private:
     // Method to show translating message
     void ShowTranslating();
 
+    // Check the server in the background, retrying with backoff until it answers
+    void StartServerProbe();
+    void OnServerProbeTimer(wxTimerEvent& event);
+
+    // Load the taskbar icon from the assets next to the executable
+    void LoadTaskBarIcon();
+
     // UI elements
     wxPanel* m_mainPanel;
     wxPanel* m_translationPanel;
@@ -76,6 +92,23 @@ private:
     // Unique pointer to the ClipboardProcessor instance.
     std::unique_ptr<ClipboardProcessor> m_clipboardProcessor;
 
+    // Local cache of earlier translations
+    std::unique_ptr<TranslationCache> m_cache;
+    bool m_revalidateCached;  // Refresh cache hits from the server in the background
+    
+    // Text recognized in earlier images; null when disabled
+    std::unique_ptr<OcrCache> m_ocrCache;
+
+    // Background OCR and translation
+    std::unique_ptr<TranslationPipeline> m_pipeline;
+
+    // Startup work that must not delay showing the window
+    wxTimer m_serverProbeTimer;
+    std::future<HttpResponse> m_serverProbe;
+    int m_serverProbeAttempts;
+    std::thread m_ocrPreload;
+    std::atomic<bool> m_ocrPreloadStop;  // Set on exit so a long warmup ends early
+
     // Add this line to your existing member variables
     wxPanel* m_waitingPanel;
 
@@ -4,13 +4,51 @@
 #include <wx/image.h>
 #include <wx/bitmap.h>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include "ocr_preprocess.h"
+#include "pixel_buffer.h"
+
+/**
+ * Time spent in each stage of one recognition, for tuning.
+ */
+struct OcrTimings {
+    double preprocessMs = 0;
+    double detectMs = 0;      // Summed over strips
+    double recognizeMs = 0;   // Summed over strips
+    double escalateMs = 0;    // Re-reading weak lines in the Auto profile, summed over strips
+    double totalMs = 0;       // Wall clock for the whole request
+    size_t strips = 0;
+    size_t regions = 0;       // Text regions recognized; 0 if whole strips were recognized
+    size_t escalatedLines = 0;
+    double textArea = 1.0;    // Fraction of the image that was recognized
+    std::string language;     // Language set that read most of the image
+};
 
 /**
  * OcrEngine provides a simple interface to Tesseract OCR.
  * It allows text recognition from wxBitmap objects or image files.
+ *
+ * Recognition runs on a pool of Tesseract instances that keep their
+ * language data loaded. Each request checks one out for its duration, so up
+ * to GetPoolSize() images are recognized concurrently; further requests wait
+ * (for at most the checkout timeout) for an instance to come back. If an
+ * idle timeout is set, idle instances are freed after that long without use
+ * and transparently recreated by the next request.
  */
 class OcrEngine {
 public:
+    /**
+     * Speed/accuracy trade-off. The model directories are set with
+     * SetModelPaths(); by default both profiles use Tesseract's own tessdata.
+     */
+    enum class Profile {
+        Fast,      // LSTM only, fast models (tessdata_fast), one block per text region
+        Accurate,  // Best models (tessdata_best), automatic page segmentation
+        Auto       // Fast, then Accurate again for lines below the escalation threshold
+    };
+    
     /**
      * Initialize the OCR engine with a specific language.
      * 
@@ -19,6 +57,95 @@ public:
      */
     static bool Initialize(const std::string& language = "eng");
     
+    /**
+     * Initialize the engine unless it already is. Safe to call from several
+     * threads; callers arriving during initialization wait for it instead of
+     * loading the language data again.
+     * 
+     * @param language Language data to use
+     * @return true if the engine is ready for use
+     */
+    static bool EnsureInitialized(const std::string& language);
+    
+    /**
+     * Initialize the engine, create the whole pool and run one tiny
+     * recognition on each instance so the first real images don't pay for
+     * lazy setup. Meant to run on a worker thread at startup.
+     * 
+     * @param language Language data to use
+     * @param stop Optional flag checked before each instance is loaded;
+     *             setting it ends the warmup early, e.g. on exit
+     * @return true if the engine is ready for use
+     */
+    static bool Warmup(const std::string& language, const std::atomic<bool>* stop = nullptr);
+    
+    /**
+     * Free the language data after this long without OCR requests; zero
+     * (the default) keeps it loaded until Cleanup().
+     */
+    static void SetIdleUnloadTimeout(std::chrono::seconds timeout);
+    
+    /**
+     * Set the number of Tesseract instances, i.e. how many images can be
+     * recognized at once. Each instance holds its own copy of the language
+     * data. Defaults to half the hardware threads.
+     */
+    static void SetPoolSize(size_t size);
+    static size_t GetPoolSize();
+    
+    /**
+     * Set how long a request waits for a free instance before giving up
+     * with an error.
+     */
+    static void SetCheckoutTimeout(std::chrono::milliseconds timeout);
+    
+    /**
+     * Set how images are prepared before recognition (grayscale, text
+     * scale normalization, deskew, binarization).
+     */
+    static void SetPreprocessOptions(const OcrPreprocess::Options& options);
+    
+    /**
+     * Find text lines with Tesseract's layout analysis on a half-size copy
+     * first, then recognize only those areas. Saves most of the time on
+     * screenshots that are largely pictures or UI chrome. On by default.
+     */
+    static void SetRegionDetection(bool enabled);
+    
+    /**
+     * When the language set holds both chi_sim and chi_tra, read a few
+     * lines with both models, tell the script from that text and read the
+     * rest with the one model only. Images too small to sample use both
+     * models throughout. On by default.
+     */
+    static void SetScriptDetection(bool enabled);
+    
+    /**
+     * Select the profile for later requests. Defaults to Accurate.
+     */
+    static void SetProfile(Profile profile);
+    static Profile GetProfile();
+    
+    /**
+     * Set the tessdata directories of the Fast and Accurate profiles, e.g.
+     * checkouts of tessdata_fast and tessdata_best. Empty uses Tesseract's
+     * default. Loaded instances are replaced.
+     */
+    static void SetModelPaths(const std::string& fastDataPath, const std::string& accurateDataPath);
+    
+    /**
+     * In the Auto profile, lines whose mean word confidence (0-100) is below
+     * this are read again with the Accurate profile. Defaults to 70. Only an
+     * Accurate instance that is already idle (or fits in the pool) is used;
+     * Warmup() keeps one slot of a pool of two or more for it.
+     */
+    static void SetEscalationThreshold(float confidence);
+    
+    /**
+     * Stage timings of the most recent recognition.
+     */
+    static OcrTimings GetLastTimings();
+    
     /**
      * Clean up OCR engine resources.
      */
@@ -32,6 +159,40 @@ public:
      */
     static wxString ExtractTextFromBitmap(const wxBitmap& bitmap);
     
+    /**
+     * Extract text from an image. Safe to call from a worker thread, since
+     * it does not touch any GUI objects.
+     * 
+     * @param image The image to process
+     * @param cancel Optional flag polled during recognition; setting it
+     *               abandons the page and returns an empty string
+     * @return Recognized text
+     */
+    static wxString ExtractTextFromImage(const wxImage& image, const std::atomic<bool>* cancel = nullptr);
+    
+    /**
+     * Extract text from shared pixels, without copying them. Safe to call
+     * from any thread.
+     */
+    static wxString ExtractTextFromImage(const PixelBuffer& pixels, const std::atomic<bool>* cancel = nullptr);
+    
+    /**
+     * Extract text from an image on a background thread.
+     * 
+     * @param image The image to process; it is copied, so the caller may
+     *              keep using it
+     * @param cancel Optional flag polled during recognition. Must stay valid
+     *               until the returned future is ready.
+     * @return Future for the recognized text
+     */
+    static std::future<wxString> ExtractTextAsync(const wxImage& image, const std::atomic<bool>* cancel = nullptr);
+    
+    /**
+     * Extract text from shared pixels on a background thread. The worker
+     * holds a reference to the pixels instead of a copy.
+     */
+    static std::future<wxString> ExtractTextAsync(const PixelBuffer& pixels, const std::atomic<bool>* cancel = nullptr);
+    
     /**
      * Extract text from an image file.
      * 
@@ -46,8 +207,13 @@ public:
      * @return true if the engine is ready for use
      */
     static bool IsInitialized();
+    
+    /**
+     * Check if any instance currently holds the language data (they may
+     * have been unloaded after an idle period).
+     */
+    static bool IsLoaded();
 
 private:
-    static void* m_tessApi;  // Opaque pointer to TessBaseAPI
-    static bool m_initialized;
+    static std::atomic<bool> m_initialized;
 }; 
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <wx/string.h>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "image_hash.h"
+
+/**
+ * Cache of OCR results, so an image that was recognized before (copied again,
+ * or re-captured from the same screen area) skips Tesseract entirely.
+ *
+ * Entries are found by an exact pixel hash first, then by the exact hash of
+ * the trimmed content: a re-capture of the same area with a different border
+ * or margin has identical content and reuses the cached text. Matching on
+ * perceptual hash distance alone is opt-in (maxDistance of zero or more), as
+ * it also matches an image with a single character changed and would return
+ * that image's text.
+ *
+ * The most recently used results are kept in memory up to a byte budget.
+ * With a path, every new result is also appended to a checksummed log that
+ * is read back on open (the same layout as TranslationCache), and the log
+ * is rewritten once it is mostly entries that no longer fit in memory.
+ * All methods are thread-safe.
+ */
+class OcrCache {
+public:
+    // Identifies an image; compute once and use for both Lookup and Store
+    struct Fingerprint {
+        uint64_t exact = 0;
+        PerceptualHash perceptual;
+    };
+
+    struct Stats {
+        size_t exactHits = 0;
+        size_t nearHits = 0;
+        size_t misses = 0;
+    };
+
+    /**
+     * @param path Log file path; empty keeps the cache in memory only
+     * @param maxMemoryBytes Budget for cached results
+     * @param maxDistance Largest perceptual hash distance (of 256 bits) for
+     *                    a near-duplicate hit with different content;
+     *                    negative (the default) requires identical content
+     */
+    explicit OcrCache(const wxString& path = wxString(), size_t maxMemoryBytes = 4 * 1024 * 1024,
+                      int maxDistance = -1);
+    ~OcrCache();
+
+    OcrCache(const OcrCache&) = delete;
+    OcrCache& operator=(const OcrCache&) = delete;
+
+    // Default log location in the user data directory
+    static wxString DefaultPath();
+
+    // Exact and perceptual hashes of an image
+    static Fingerprint ComputeFingerprint(const PixelBuffer& pixels);
+
+    // Find the text recognized in the same or a nearly identical image
+    bool Lookup(const Fingerprint& fingerprint, wxString& text);
+
+    // Remember the text recognized in an image
+    void Store(const Fingerprint& fingerprint, const wxString& text);
+
+    size_t Size() const;
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        Fingerprint fingerprint;
+        std::string text;  // UTF-8
+    };
+
+    static size_t EntryBytes(const Entry& entry);
+    bool IsNearDuplicate(const Fingerprint& a, const Fingerprint& b) const;
+
+    // Called with m_mutex held
+    void Load();
+    void Rewrite();
+    bool Append(const Entry& entry);
+    void Remember(Entry entry);
+
+    std::string m_path;
+    size_t m_maxMemoryBytes;
+    int m_maxDistance;
+
+    mutable std::mutex m_mutex;
+    std::fstream m_file;
+    uint64_t m_fileSize;
+
+    std::list<Entry> m_lru;  // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+    size_t m_lruBytes;
+    Stats m_stats;
+};
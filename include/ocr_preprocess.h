@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 8-bit grayscale image, rows stored contiguously (stride == width).
+ */
+struct GrayImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    GrayImage() = default;
+    GrayImage(int w, int h, uint8_t fill = 255) : width(w), height(h), pixels(static_cast<size_t>(w) * h, fill) {}
+
+    bool IsOk() const { return width > 0 && height > 0; }
+    uint8_t* Row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+    const uint8_t* Row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+};
+
+/**
+ * Image preparation in front of Tesseract.
+ *
+ * Screenshots arrive as RGB at whatever size the text happened to be
+ * rendered. Tesseract is fastest and most accurate on a single channel with
+ * glyphs around 30-40 px tall, dark on light. Prepare() converts to gray,
+ * rescales so text lines land near that height, optionally straightens the
+ * page, and binarizes.
+ */
+namespace OcrPreprocess {
+
+    enum class Binarization {
+        None,     // Leave 8-bit gray; Tesseract thresholds it itself
+        Otsu,     // One global threshold; fine for flat UI backgrounds
+        Sauvola   // Local threshold; copes with gradients and uneven lighting
+    };
+
+    struct Options {
+        Binarization binarization = Binarization::Sauvola;
+        int sauvolaWindow = 25;          // Window size in pixels (after scaling)
+        double sauvolaK = 0.2;           // Sensitivity; higher keeps less ink
+        bool normalizeScale = true;      // Rescale to targetTextHeight
+        int targetTextHeight = 36;       // Text line height Tesseract reads best, in pixels
+        double minScale = 0.25;
+        double maxScale = 4.0;
+        int maxDimension = 2000;         // Never produce images larger than this, unless tiled
+        bool deskew = false;             // Estimate and undo small rotations (up to 5 degrees)
+
+        // Tiled mode: tall or large images are cut into horizontal strips at
+        // the gaps between text lines and the strips are recognized in
+        // parallel, so large captures keep their resolution instead of
+        // being shrunk to maxDimension
+        bool tiled = true;
+        int maxTiledWidth = 4096;
+        int maxTiledHeight = 16384;
+        int stripHeight = 1200;          // Preferred strip height in pixels
+        int stripOverlap = 64;           // Overlap where a strip has to cut through text
+    };
+
+    // Horizontal strip of a prepared image: rows [top, bottom)
+    struct Strip {
+        int top = 0;
+        int bottom = 0;
+        bool overlapsPrevious = false;   // Cut through text; shares rows with the strip above
+    };
+
+    // Facts about one Prepare() run
+    struct Report {
+        double scale = 1.0;              // Applied scale factor
+        int textHeight = 0;              // Estimated line height before scaling, 0 if unknown
+        double skewDegrees = 0.0;        // Rotation that was undone
+        bool inverted = false;           // Light text on a dark background was flipped
+        bool limitedByMaxDimension = false;
+    };
+
+    // Cheap evidence of text, measured on a grid of small cells: glyph
+    // strokes show up as cells with strong two-toned contrast next to
+    // quiet cells (the plain background text is drawn on). Photos and
+    // gradients have noise or texture instead of quiet cells, blank images
+    // have no contrast; both score (close to) zero.
+    struct TextEvidence {
+        size_t cells = 0;       // Cells in the grid
+        size_t textCells = 0;   // Cells that look like strokes on a plain background
+    };
+
+    // Measure text evidence on a row-subsampled pass over packed RGB; takes
+    // under a millisecond even on large screenshots
+    TextEvidence MeasureTextEvidence(const uint8_t* rgb, int width, int height, size_t stride);
+
+    // Convert packed RGB to gray using integer BT.601 weights
+    GrayImage ToGray(const uint8_t* rgb, int width, int height, size_t stride);
+
+    // Global threshold that best separates the two histogram modes
+    uint8_t OtsuThreshold(const GrayImage& image);
+
+    // Binarize in place: ink becomes 0, background 255
+    void BinarizeOtsu(GrayImage& image);
+    void BinarizeSauvola(GrayImage& image, int window, double k);
+
+    // Area-averaging resample for shrinking, bilinear for enlarging
+    GrayImage Resample(const GrayImage& image, int newWidth, int newHeight);
+
+    // Median height of text lines from the row profile of a binary image,
+    // 0 if no lines are found
+    int EstimateTextHeight(const GrayImage& binary);
+
+    // Skew angle in degrees (positive = text rises to the right) that
+    // maximizes the sharpness of the row profile of a binary image
+    double EstimateSkew(const GrayImage& binary, double maxDegrees = 5.0, double stepDegrees = 0.25);
+
+    // Rotate by the given angle around the center, filling with white
+    GrayImage Rotate(const GrayImage& image, double degrees);
+
+    // Split an image into strips of about stripHeight rows. Cuts are placed
+    // in blank rows between text lines where possible; where text runs
+    // through the whole search range the cut overlaps by `overlap` rows.
+    // A positive firstStripHeight makes the first strip that tall instead,
+    // e.g. to read a small sample before the rest.
+    std::vector<Strip> PlanStrips(const GrayImage& image, int stripHeight, int overlap,
+                                  int firstStripHeight = 0);
+
+    // Full pipeline on packed RGB data
+    GrayImage Prepare(const uint8_t* rgb, int width, int height, size_t stride,
+                      const Options& options, Report* report = nullptr);
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <wx/bitmap.h>
+#include <wx/gdicmn.h>
+#include <wx/image.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Packed RGB pixels shared by the clipboard reader, the screenshot tool, the
+ * image hashes, preprocessing and OCR.
+ *
+ * A clipboard image used to be converted from wxBitmap to wxImage once for
+ * the change check and again for OCR, each time into a new full-size
+ * buffer. A PixelBuffer is filled once and then only passed around: copies
+ * share the pixels, which are never modified, and the reference count is
+ * atomic, so unlike a wxImage a buffer may be handed to worker threads
+ * as is.
+ */
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+
+    // Take over the pixels of an image. They are copied only if the image
+    // is still shared, e.g. with a wxImage the caller keeps.
+    explicit PixelBuffer(wxImage image);
+
+    // Read a bitmap in one pass, directly from its native pixels where the
+    // platform allows (bitmaps without alpha), otherwise through wxImage
+    static PixelBuffer FromBitmap(const wxBitmap& bitmap);
+
+    // Read only the given area of a bitmap, e.g. a screenshot selection
+    static PixelBuffer FromBitmap(const wxBitmap& bitmap, const wxRect& area);
+
+    // Decode encoded image data (PNG, TIFF, ...) straight into a buffer
+    static PixelBuffer Decode(const void* bytes, size_t size, wxBitmapType type = wxBITMAP_TYPE_ANY);
+
+    bool IsOk() const { return m_pixels != nullptr; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    size_t GetStride() const { return static_cast<size_t>(m_width) * 3; }  // Bytes per row
+
+    // Rows stored contiguously, 3 bytes per pixel
+    const uint8_t* GetData() const { return m_pixels; }
+
+    // One byte per pixel, or nullptr if the source had no alpha channel
+    const uint8_t* GetAlpha() const { return m_alpha; }
+
+private:
+    struct Storage;
+
+    explicit PixelBuffer(std::shared_ptr<const Storage> storage);
+
+    std::shared_ptr<const Storage> m_storage;
+    const uint8_t* m_pixels = nullptr;
+    const uint8_t* m_alpha = nullptr;
+    int m_width = 0;
+    int m_height = 0;
+};
@@ -3,15 +3,16 @@
 
 #include <wx/wx.h>
 #include <functional>
+#include "pixel_buffer.h"
 
 // Callback function type for receiving the screenshot
-typedef std::function<void(wxBitmap)> ScreenshotCallback;
+typedef std::function<void(const PixelBuffer&)> ScreenshotCallback;
 
 /**
  * Launches a screenshot selection tool that allows the user to select
  * an area of the screen. The selected area will be returned via the callback.
  * 
- * @param callback Function to call with the screenshot bitmap
+ * @param callback Function to call with the pixels of the selected area
  */
 void LaunchScreenshotTool(ScreenshotCallback callback);
 
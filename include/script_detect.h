@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Tells Simplified from Traditional Chinese text.
+ *
+ * Most characters are written the same in both scripts, but a few hundred
+ * of the most frequent ones differ (这/這, 说/說, 们/們, ...). Counting
+ * those in a short piece of recognized text is enough to tell which script
+ * an image uses, so the rest of it can be read with a single-script model.
+ */
+namespace ScriptDetect {
+
+    enum class Script {
+        Unknown,      // Too little evidence, or both scripts mixed
+        Simplified,
+        Traditional
+    };
+
+    struct Result {
+        Script script = Script::Unknown;
+        size_t simplified = 0;   // Characters found only in Simplified text
+        size_t traditional = 0;  // Characters found only in Traditional text
+        double confidence = 0;   // Share of the evidence for the winning script
+    };
+
+    // Classify UTF-8 text. Script::Unknown unless there are at least
+    // minEvidence distinguishing characters and the winning share reaches
+    // minConfidence.
+    Result Classify(const std::string& utf8, size_t minEvidence = 3, double minConfidence = 0.85);
+
+    const char* ToString(Script script);
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * Timing trace for application startup.
+ *
+ * Each Mark() prints the time since the first mark and since the previous
+ * one, so a slow phase shows up in the console output. Safe to call from
+ * worker threads (e.g. when background warm-up finishes).
+ */
+namespace StartupTrace {
+
+    // Record that a startup phase has finished
+    void Mark(const char* phase);
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <wx/string.h>
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Local cache of server translations, so text that was translated before is
+ * shown instantly and still works with the backend down.
+ *
+ * Responses are kept in an append-only log on disk (one checksummed record
+ * per translation) with an in-memory index of key -> file offset, and the
+ * most recently used responses are also kept parsed in an LRU. A torn record
+ * at the end of the log (e.g. after a crash) is dropped on open, and the log
+ * is compacted on open once more than half of it is superseded records.
+ *
+ * Keys are the canonical form of the text (surrounding ASCII and ideographic
+ * whitespace removed). All methods are thread-safe.
+ */
+class TranslationCache {
+public:
+    /**
+     * @param path Log file path; created if missing
+     * @param maxMemoryBytes Budget for parsed responses kept in memory
+     */
+    explicit TranslationCache(const wxString& path, size_t maxMemoryBytes = 16 * 1024 * 1024);
+    ~TranslationCache();
+
+    TranslationCache(const TranslationCache&) = delete;
+    TranslationCache& operator=(const TranslationCache&) = delete;
+
+    // Default location in the user data directory
+    static wxString DefaultPath();
+
+    // Find a cached response for the text
+    bool Lookup(const wxString& text, nlohmann::json& response);
+
+    // Remember the server's response for the text
+    bool Store(const wxString& text, const nlohmann::json& response);
+
+    // Number of cached translations
+    size_t Size() const;
+
+    // True if the log file could be opened
+    bool IsOk() const { return m_file.is_open(); }
+
+private:
+    struct IndexEntry {
+        uint64_t valueOffset;
+        uint32_t valueLength;
+    };
+
+    struct LruEntry {
+        std::string key;
+        nlohmann::json response;
+        size_t bytes;
+    };
+
+    static std::string CanonicalKey(const wxString& text);
+
+    // Called with m_mutex held
+    void Load();
+    void Compact();
+    bool Append(const std::string& key, const std::string& value);
+    void Remember(const std::string& key, const nlohmann::json& response, size_t bytes);
+
+    std::string m_path;
+    size_t m_maxMemoryBytes;
+
+    mutable std::mutex m_mutex;
+    std::fstream m_file;
+    uint64_t m_fileSize;
+    uint64_t m_liveBytes;  // Bytes of records that are still current
+
+    std::unordered_map<std::string, IndexEntry> m_index;
+
+    std::list<LruEntry> m_lru;  // Most recently used first
+    std::unordered_map<std::string, std::list<LruEntry>::iterator> m_lruIndex;
+    size_t m_lruBytes;
+};
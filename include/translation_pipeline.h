@@ -0,0 +1,128 @@
+#pragma once
+
+#include <wx/wx.h>
+#include <wx/image.h>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "ocr_cache.h"
+#include "pixel_buffer.h"
+#include "translation_cache.h"
+
+/**
+ * Outcome of one clipboard translation.
+ */
+struct TranslationResult {
+    enum class Status {
+        Translated,   // response holds the server's translation
+        NoText,       // OCR found no text in the image
+        NotText,      // The image doesn't look like text; OCR was skipped
+        TooMuchText,  // text is longer than the configured maximum
+        Failed        // error describes what went wrong
+    };
+
+    Status status = Status::Failed;
+    wxString text;            // Copied or recognized text
+    nlohmann::json response;
+    wxString error;
+    bool fromCache = false;     // Answered from the local cache without a request
+    bool revalidation = false;  // Background refresh of a translation already shown
+};
+
+/**
+ * Runs clipboard translations on a background thread.
+ *
+ * Each job goes through an OCR stage (images only) and then a network
+ * stage. Only the newest job matters: submitting a job cancels the one in
+ * flight (OCR and HTTP both poll its cancel flag) and replaces any job that
+ * hasn't started yet, so rapid copies never queue up. Results are delivered
+ * on the UI thread through the owner's CallAfter, and only for the newest job.
+ *
+ * With a cache, text (including text recognized by OCR) that was translated
+ * before is answered locally, and new translations are stored in it. With an
+ * OCR cache, images recognized before (or near-duplicates of them) skip OCR.
+ * Images without any sign of text (photos, blank areas) are rejected by a
+ * cheap check before the OCR engine is touched.
+ */
+class TranslationPipeline {
+public:
+    // Performs the network request; runs on the worker thread
+    using Translator = std::function<nlohmann::json(const wxString& text, const std::atomic<bool>& cancelled)>;
+    using ResultCallback = std::function<void(const TranslationResult& result)>;
+
+    /**
+     * @param owner Handler whose CallAfter delivers results (must outlive the pipeline)
+     * @param translator Function that translates text
+     * @param onResult Called on the UI thread with the newest job's result
+     * @param maxTextLength Longer texts are rejected without a request
+     * @param cache Optional local cache (must outlive the pipeline)
+     * @param ocrCache Optional cache of OCR results (must outlive the pipeline)
+     */
+    TranslationPipeline(wxEvtHandler* owner, Translator translator, ResultCallback onResult,
+                        size_t maxTextLength, TranslationCache* cache = nullptr,
+                        OcrCache* ocrCache = nullptr);
+    ~TranslationPipeline();
+
+    TranslationPipeline(const TranslationPipeline&) = delete;
+    TranslationPipeline& operator=(const TranslationPipeline&) = delete;
+
+    // Translate copied text, superseding any earlier job. A revalidation
+    // skips the cache and refreshes it from the server.
+    void SubmitText(const wxString& text, bool revalidate = false);
+
+    // Recognize and translate an image, superseding any earlier job. The
+    // pixels are shared with the worker, not copied.
+    void SubmitImage(const PixelBuffer& image);
+
+    // Images with fewer cells of text evidence than this (see
+    // OcrPreprocess::MeasureTextEvidence) are rejected without OCR. 0 sends
+    // every image to OCR.
+    void SetTextThreshold(size_t minTextCells);
+    size_t GetTextThreshold() const;
+
+    // Number of images rejected by the text check
+    size_t GetRejectedImages() const;
+
+    // Cancel the current job without starting a new one
+    void Cancel();
+
+    // True while a job is pending or running
+    bool IsBusy() const;
+
+private:
+    struct Job {
+        uint64_t generation = 0;
+        wxString text;
+        PixelBuffer image;
+        bool revalidate = false;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    void Submit(Job job);
+    void Run();
+    void Process(Job& job);
+    void Deliver(const Job& job, TranslationResult result);
+    bool LooksLikeText(const PixelBuffer& image);
+
+    wxEvtHandler* m_owner;
+    Translator m_translator;
+    ResultCallback m_onResult;
+    size_t m_maxTextLength;
+    TranslationCache* m_cache;
+    OcrCache* m_ocrCache;
+    std::atomic<size_t> m_minTextCells;
+    std::atomic<size_t> m_rejectedImages;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::optional<Job> m_pending;                    // Newest job not yet started
+    std::shared_ptr<std::atomic<bool>> m_running;    // Cancel flag of the job in flight
+    std::atomic<uint64_t> m_generation;
+    bool m_stopping;
+    std::thread m_worker;
+};
@@ -1,32 +1,200 @@
 #include "../include/clipboard_processor.h"
+#include "../include/image_hash.h"
 #include <wx/log.h>
-#include <wx/mstream.h>  // for wxMemoryInputStream
-#include <wx/image.h>    // for wxImage loading from stream
-#include <wx/file.h>
-#include <wx/filename.h>  // For wxFileName
 #include <wx/datetime.h> // For timestamp functionality
 
+// Platform-specific includes
+#if defined(__WXGTK__) && defined(HAVE_XFIXES)
+#include <X11/Xlib.h>
+#include <X11/extensions/Xfixes.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <thread>
+#endif
+
 // Define a struct to hold clipboard content with timestamp
 struct ClipboardData {
     wxString textContent;
-    wxBitmap imageContent;
+    uint64_t imageHash;   // Pixel hash of the image; the bitmap itself isn't kept
+    int imageWidth;
+    int imageHeight;
     bool hasText;
     bool hasImage;
     wxDateTime timestamp;
     
-    ClipboardData() : hasText(false), hasImage(false) {
+    ClipboardData() : imageHash(0), imageWidth(0), imageHeight(0), hasText(false), hasImage(false) {
         timestamp = wxDateTime::Now();
     }
 };
 
-ClipboardProcessor::ClipboardProcessor()
-    : m_initialized(false)
+// Clipboard content waiting for its burst to settle
+struct ClipboardProcessor::PendingChange {
+    bool isImage = false;
+    wxString text;
+    PixelBuffer image;
+    uint64_t imageHash = 0;
+    wxDateTime timestamp;
+};
+
+// Default settle window; long enough to span a quick re-copy while refining
+// a selection, short enough not to be noticed
+static const int DEFAULT_SETTLE_MS = 300;
+
+// Reports clipboard ownership changes so the clipboard is only read when it
+// actually changes. Implemented with XFixes on X11; on other platforms
+// Start() returns false and the processor falls back to polling.
+class ClipboardProcessor::ChangeWatcher
+{
+public:
+    explicit ChangeWatcher(std::function<void()> onChange) : m_onChange(onChange) {}
+    ~ChangeWatcher() { Stop(); }
+
+    // Start watching CLIPBOARD (and PRIMARY if requested)
+    bool Start(bool watchPrimary);
+    void Stop();
+    bool IsRunning() const { return m_running; }
+
+private:
+    std::function<void()> m_onChange;  // Called on the watcher thread
+    bool m_running = false;
+
+#if defined(__WXGTK__) && defined(HAVE_XFIXES)
+    void Run();
+
+    Display* m_display = nullptr;  // Own connection, only used by m_thread
+    int m_eventBase = 0;
+    int m_wakePipe[2] = {-1, -1};  // Written by Stop() to end the thread
+    std::thread m_thread;
+#endif
+};
+
+#if defined(__WXGTK__) && defined(HAVE_XFIXES)
+bool ClipboardProcessor::ChangeWatcher::Start(bool watchPrimary)
 {
-    // Make sure image handlers are initialized
-    wxInitAllImageHandlers();
+    if (m_running)
+        return true;
+    
+    // Fails under a pure Wayland session, where we keep polling
+    m_display = XOpenDisplay(nullptr);
+    if (!m_display) {
+        wxLogDebug("ChangeWatcher: no X display, falling back to polling");
+        return false;
+    }
     
+    int errorBase = 0;
+    if (!XFixesQueryExtension(m_display, &m_eventBase, &errorBase)) {
+        wxLogDebug("ChangeWatcher: XFixes not available, falling back to polling");
+        XCloseDisplay(m_display);
+        m_display = nullptr;
+        return false;
+    }
+    
+    if (pipe2(m_wakePipe, O_CLOEXEC) != 0) {
+        XCloseDisplay(m_display);
+        m_display = nullptr;
+        return false;
+    }
+    
+    const unsigned long mask = XFixesSetSelectionOwnerNotifyMask |
+                               XFixesSelectionWindowDestroyNotifyMask |
+                               XFixesSelectionClientCloseNotifyMask;
+    Window root = DefaultRootWindow(m_display);
+    XFixesSelectSelectionInput(m_display, root, XInternAtom(m_display, "CLIPBOARD", False), mask);
+    if (watchPrimary) {
+        XFixesSelectSelectionInput(m_display, root, XInternAtom(m_display, "PRIMARY", False), mask);
+    }
+    XFlush(m_display);
+    
+    m_running = true;
+    m_thread = std::thread(&ChangeWatcher::Run, this);
+    return true;
+}
+
+void ClipboardProcessor::ChangeWatcher::Stop()
+{
+    if (!m_running)
+        return;
+    
+    char wake = 1;
+    if (write(m_wakePipe[1], &wake, 1) < 0) {
+        wxLogDebug("ChangeWatcher: failed to wake watcher thread");
+    }
+    m_thread.join();
+    
+    XCloseDisplay(m_display);
+    m_display = nullptr;
+    close(m_wakePipe[0]);
+    close(m_wakePipe[1]);
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+    m_running = false;
+}
+
+void ClipboardProcessor::ChangeWatcher::Run()
+{
+    struct pollfd fds[2];
+    fds[0].fd = ConnectionNumber(m_display);
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakePipe[0];
+    fds[1].events = POLLIN;
+    
+    while (true) {
+        // Drain everything already queued, then report one change per wakeup
+        bool changed = false;
+        while (XPending(m_display) > 0) {
+            XEvent event;
+            XNextEvent(m_display, &event);
+            if (event.type == m_eventBase + XFixesSelectionNotify) {
+                changed = true;
+            }
+        }
+        if (changed) {
+            m_onChange();
+        }
+        
+        // Sleep until the X server or Stop() has something for us
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents != 0 || (fds[0].revents & (POLLERR | POLLHUP)) != 0)
+            break;
+    }
+}
+#else
+bool ClipboardProcessor::ChangeWatcher::Start(bool WXUNUSED(watchPrimary))
+{
+    // No change notifications on this platform
+    return false;
+}
+
+void ClipboardProcessor::ChangeWatcher::Stop()
+{
+}
+#endif
+
+ClipboardProcessor::ClipboardProcessor()
+    : m_initialized(false), m_changePending(false),
+      m_settleTimer(this), m_settleMs(DEFAULT_SETTLE_MS), m_lastDispatchedImageHash(0)
+{
     // Initialize the current clipboard data
     m_clipboardData = std::make_shared<ClipboardData>();
+    
+    m_watcher = std::make_unique<ChangeWatcher>([this]() {
+        // Coalesce bursts of notifications into one read on the UI thread
+        if (!m_changePending.exchange(true)) {
+            CallAfter([this]() {
+                m_changePending = false;
+                ProcessClipboard();
+            });
+        }
+    });
+    
+    Bind(wxEVT_TIMER, &ClipboardProcessor::OnSettleTimer, this, m_settleTimer.GetId());
 }
 
 ClipboardProcessor::~ClipboardProcessor()
@@ -35,7 +203,7 @@ ClipboardProcessor::~ClipboardProcessor()
 }
 
 bool ClipboardProcessor::Initialize(std::function<void(const wxString&, const wxDateTime&)> textCallback, 
-                                   std::function<void(const wxBitmap&, const wxDateTime&)> imageCallback)
+                                   std::function<void(const PixelBuffer&, const wxDateTime&)> imageCallback)
 {
     if (m_initialized)
         return true;
@@ -56,6 +224,13 @@ bool ClipboardProcessor::Start(int checkIntervalMs)
         return false;
     }
     
+    // Prefer change notifications; the timer is only needed without them
+    if (m_watcher->Start(wxTheClipboard->IsUsingPrimarySelection())) {
+        wxLogDebug("ClipboardProcessor started, waiting for clipboard change notifications");
+        ProcessClipboard();
+        return true;
+    }
+    
     // Start the timer to check clipboard periodically
     bool success = wxTimer::Start(checkIntervalMs);
     if (success) {
@@ -73,10 +248,91 @@ bool ClipboardProcessor::Start(int checkIntervalMs)
 
 void ClipboardProcessor::Stop()
 {
+    if (m_watcher && m_watcher->IsRunning()) {
+        m_watcher->Stop();
+        wxLogDebug("ClipboardProcessor stopped watching for clipboard changes");
+    }
+    
     if (IsRunning()) {
         wxTimer::Stop();
         wxLogDebug("ClipboardProcessor stopped");
     }
+    
+    // Content still settling was copied while monitoring was on, but the
+    // user has since turned it off
+    m_settleTimer.Stop();
+    m_pendingChange.reset();
+}
+
+void ClipboardProcessor::SetSettleInterval(int settleMs)
+{
+    m_settleMs = settleMs > 0 ? settleMs : 0;
+}
+
+int ClipboardProcessor::GetSettleInterval() const
+{
+    return m_settleMs;
+}
+
+ClipboardDispatchStats ClipboardProcessor::GetDispatchStats() const
+{
+    return m_stats;
+}
+
+void ClipboardProcessor::QueueChange(std::unique_ptr<PendingChange> change)
+{
+    if (m_pendingChange) {
+        ++m_stats.suppressed;
+        wxLogDebug("Clipboard change from %s superseded before it settled",
+                   m_pendingChange->timestamp.Format("%H:%M:%S"));
+    }
+    m_pendingChange = std::move(change);
+    
+    if (m_settleMs == 0) {
+        DispatchPending();
+        return;
+    }
+    
+    // Restart the window; it only fires once the clipboard is quiet
+    m_settleTimer.StartOnce(m_settleMs);
+}
+
+void ClipboardProcessor::OnSettleTimer(wxTimerEvent& WXUNUSED(event))
+{
+    DispatchPending();
+}
+
+void ClipboardProcessor::DispatchPending()
+{
+    std::unique_ptr<PendingChange> change = std::move(m_pendingChange);
+    if (!change) {
+        return;
+    }
+    
+    // A burst that ends where it started (A, B, A) changes nothing
+    bool unchanged = change->isImage ? change->imageHash == m_lastDispatchedImageHash
+                                     : change->text == m_lastDispatchedText;
+    if (unchanged) {
+        ++m_stats.suppressed;
+        wxLogDebug("Clipboard burst settled on the content already dispatched");
+        return;
+    }
+    
+    ++m_stats.dispatched;
+    if (change->isImage) {
+        m_lastDispatchedImageHash = change->imageHash;
+        m_lastDispatchedText = wxEmptyString;
+        if (m_imageCallback) {
+            m_imageCallback(change->image, change->timestamp);
+        }
+    } else {
+        m_lastDispatchedText = change->text;
+        m_lastDispatchedImageHash = 0;
+        if (m_textCallback) {
+            wxLogDebug("ClipboardProcessor: dispatching %zu characters of text", change->text.length());
+            m_textCallback(change->text, change->timestamp);
+        }
+    }
 }
 
 bool ClipboardProcessor::ProcessClipboard()
@@ -227,11 +483,11 @@ bool ClipboardProcessor::ProcessTextFormat()
         m_clipboardData->hasText = true;
         m_clipboardData->timestamp = wxDateTime::Now();
         
-        // Call the text callback if provided
-        if (m_textCallback) {
-            std::cout << "ClipboardProcessor::ProcessTextFormat: Calling text callback on: text: " << clipboardText << " timestamp: " << m_clipboardData->timestamp.Format("%Y-%m-%d %H:%M:%S") << std::endl;
-            m_textCallback(clipboardText, m_clipboardData->timestamp);
-        }
+        // Hand it to the text callback once the burst settles
+        auto change = std::make_unique<PendingChange>();
+        change->text = clipboardText;
+        change->timestamp = m_clipboardData->timestamp;
+        QueueChange(std::move(change));
         return true;
     }
     
@@ -256,14 +512,16 @@ wxString ClipboardProcessor::GetClipboardText()
 
 bool ClipboardProcessor::ProcessImageFormat()
 {
-    wxBitmap newImage;
+    // The pixels are read out of the clipboard once; the hash below, the
+    // pending change and the image callback all share this buffer
+    PixelBuffer newImage;
     bool gotImage = false;
     
     // Try to get the image in various formats
     if (HasFormatType(wxDF_BITMAP)) {
         wxBitmapDataObject data;
         if (wxTheClipboard->GetData(data)) {
-            newImage = data.GetBitmap();
+            newImage = PixelBuffer::FromBitmap(data.GetBitmap());
             gotImage = newImage.IsOk();
         }
     }
@@ -272,19 +530,11 @@ bool ClipboardProcessor::ProcessImageFormat()
     // Try Mac-specific formats if standard bitmap format didn't work
     if (!gotImage) {
         if (HasFormatName("public.png") || HasFormatName("PNG") || HasFormatName("image/png")) {
-            wxBitmap macImage;
-            if (GetPngImage(macImage)) {
-                newImage = macImage;
-                gotImage = true;
-            }
+            gotImage = GetPngImage(newImage);
         }
         
         if (!gotImage && HasFormatName("public.tiff")) {
-            wxBitmap macImage;
-            if (GetTiffImage(macImage)) {
-                newImage = macImage;
-                gotImage = true;
-            }
+            gotImage = GetTiffImage(newImage);
         }
     }
     #endif
@@ -294,50 +544,33 @@ bool ClipboardProcessor::ProcessImageFormat()
         wxLogDebug("Clipboard contains a bitmap image: %d x %d", 
                   newImage.GetWidth(), newImage.GetHeight());
         
-        // Check if this is a new image
-        bool isNewImage = false;
+        // Compare a hash of the raw pixels with the previous image. A size
+        // change is caught first without touching the pixels.
+        bool isNewImage = !m_clipboardData || !m_clipboardData->hasImage ||
+                          m_clipboardData->imageWidth != newImage.GetWidth() ||
+                          m_clipboardData->imageHeight != newImage.GetHeight();
         
-        if (!m_clipboardData || !m_clipboardData->hasImage) {
+        uint64_t imageHash = HashImagePixels(newImage);
+        if (!isNewImage && m_clipboardData->imageHash != imageHash) {
             isNewImage = true;
-        } else {
-            // Always treat as new image if dimensions changed
-            if (m_clipboardData->imageContent.GetWidth() != newImage.GetWidth() ||
-                m_clipboardData->imageContent.GetHeight() != newImage.GetHeight()) {
-                isNewImage = true;
-            } else {
-                // Compare actual image data for images of same size
-                // We'll use a simple hash-based approach by converting to PNG and checking size
-                wxMemoryOutputStream stream1;
-                wxMemoryOutputStream stream2;
-                m_clipboardData->imageContent.ConvertToImage().SaveFile(stream1, wxBITMAP_TYPE_PNG);
-                newImage.ConvertToImage().SaveFile(stream2, wxBITMAP_TYPE_PNG);
-                
-                if (stream1.GetLength() != stream2.GetLength()) {
-                    isNewImage = true;
-                } else {
-                    // Compare first few bytes as an additional check
-                    const size_t bytesToCheck = std::min<size_t>(static_cast<size_t>(stream1.GetLength()), static_cast<size_t>(1024));
-                    wxStreamBuffer* buf1 = stream1.GetOutputStreamBuffer();
-                    wxStreamBuffer* buf2 = stream2.GetOutputStreamBuffer();
-                    
-                    if (memcmp(buf1->GetBufferStart(), buf2->GetBufferStart(), bytesToCheck) != 0) {
-                        isNewImage = true;
-                    }
-                }
-            }
         }
         
         if (isNewImage) {
             // Update clipboard data with timestamp only for new images
             m_clipboardData = std::make_shared<ClipboardData>();
-            m_clipboardData->imageContent = newImage;
+            m_clipboardData->imageHash = imageHash;
+            m_clipboardData->imageWidth = newImage.GetWidth();
+            m_clipboardData->imageHeight = newImage.GetHeight();
             m_clipboardData->hasImage = true;
             m_clipboardData->timestamp = wxDateTime::Now();
             
-            // Call the image callback if provided
-            if (m_imageCallback) {
-                m_imageCallback(newImage, m_clipboardData->timestamp);
-            }
+            // Hand it to the image callback once the burst settles
+            auto change = std::make_unique<PendingChange>();
+            change->isImage = true;
+            change->image = newImage;
+            change->imageHash = imageHash;
+            change->timestamp = m_clipboardData->timestamp;
+            QueueChange(std::move(change));
             return true;
         }
     }
@@ -375,7 +608,7 @@ wxBitmap ClipboardProcessor::GetClipboardImage()
 }
 
 #ifdef __WXMAC__
-bool ClipboardProcessor::GetPngImage(wxBitmap& bitmap)
+bool ClipboardProcessor::GetPngImage(PixelBuffer& pixels)
 {
     wxLogDebug("Attempting to get macOS PNG image from clipboard");
     
@@ -395,41 +628,16 @@ bool ClipboardProcessor::GetPngImage(wxBitmap& bitmap)
     wxLogDebug("Successfully got PNG data from clipboard, size: %zu bytes", 
                dataObj.GetSize());
     
-    // Try multiple approaches to convert the PNG data
-    
-    // 1. Try memory stream approach
-    wxMemoryInputStream memStream(dataObj.GetData(), dataObj.GetSize());
-    wxImage image;
-    if (image.LoadFile(memStream)) {
-        bitmap = wxBitmap(image);
-        return bitmap.IsOk();
-    }
-    
-    // 2. Try temporary file approach
-    // Save the data to a temporary file
-    wxString tempFilePath = wxFileName::GetTempDir() + wxFILE_SEP_PATH + 
-                           "clipboard_temp.png";
-    wxFile tempFile(tempFilePath, wxFile::write);
-    
-    if (!tempFile.IsOpened()) {
-        wxLogDebug("Failed to create temporary file");
-        return false;
-    }
-    
-    tempFile.Write(dataObj.GetData(), dataObj.GetSize());
-    tempFile.Close();
-    wxLogDebug("Saved image data to temporary file: %s", tempFilePath);
-    
-    // Try to load the image from the file
-    if (image.LoadFile(tempFilePath)) {
-        bitmap = wxBitmap(image);
-        return bitmap.IsOk();
+    // Decode in memory straight into the buffer; a temporary file holds the
+    // same bytes, so it can't succeed where this fails
+    pixels = PixelBuffer::Decode(dataObj.GetData(), dataObj.GetSize(), wxBITMAP_TYPE_PNG);
+    if (!pixels.IsOk()) {
+        wxLogDebug("Failed to decode PNG data from clipboard");
     }
-    
-    return false;
+    return pixels.IsOk();
 }
 
-bool ClipboardProcessor::GetTiffImage(wxBitmap& bitmap)
+bool ClipboardProcessor::GetTiffImage(PixelBuffer& pixels)
 {
     wxLogDebug("Attempting to get macOS TIFF image from clipboard");
     
@@ -448,36 +656,11 @@ bool ClipboardProcessor::GetTiffImage(wxBitmap& bitmap)
     wxLogDebug("Successfully got TIFF data from clipboard, size: %zu bytes", 
                dataObj.GetSize());
     
-    // 1. Try memory stream approach
-    wxMemoryInputStream memStream(dataObj.GetData(), dataObj.GetSize());
-    wxImage image;
-    if (image.LoadFile(memStream, wxBITMAP_TYPE_TIFF)) {
-        bitmap = wxBitmap(image);
-        return bitmap.IsOk();
-    }
-    
-    // 2. Try temporary file approach
-    // Save the data to a temporary file
-    wxString tempFilePath = wxFileName::GetTempDir() + wxFILE_SEP_PATH + 
-                           "clipboard_temp.tiff";
-    wxFile tempFile(tempFilePath, wxFile::write);
-    
-    if (!tempFile.IsOpened()) {
-        wxLogDebug("Failed to create temporary file");
-        return false;
-    }
-    
-    tempFile.Write(dataObj.GetData(), dataObj.GetSize());
-    tempFile.Close();
-    wxLogDebug("Saved image data to temporary file: %s", tempFilePath);
-    
-    // Try to load the image from the file
-    if (image.LoadFile(tempFilePath, wxBITMAP_TYPE_TIFF)) {
-        bitmap = wxBitmap(image);
-        return bitmap.IsOk();
+    pixels = PixelBuffer::Decode(dataObj.GetData(), dataObj.GetSize(), wxBITMAP_TYPE_TIFF);
+    if (!pixels.IsOk()) {
+        wxLogDebug("Failed to decode TIFF data from clipboard");
     }
-    
-    return false;
+    return pixels.IsOk();
 }
 #endif
 
@@ -495,6 +678,11 @@ bool ClipboardProcessor::TryGetImageFromClipboard(wxBitmap& bitmap)
     return false;
 }
 
+bool ClipboardProcessor::IsEventDriven() const
+{
+    return m_watcher && m_watcher->IsRunning();
+}
+
 // Add new accessor methods for clipboard data with timestamps
 wxDateTime ClipboardProcessor::GetCurrentTimestamp() const
 {
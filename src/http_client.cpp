@@ -1,148 +1,323 @@
 #include "../include/http_client.h"
 #include <curl/curl.h>
-#include <sstream>
 #include <wx/log.h>
-#include <iostream>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-size_t HttpClient::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+// Legacy helpers used a 5 minute limit, which the LLM endpoint can need
+static const std::chrono::milliseconds LEGACY_TIMEOUT(300000);
+
+// Idle easy handles kept for reuse
+static const size_t MAX_IDLE_HANDLES = 4;
+
+// One request in flight
+struct Transfer {
+    CURL* easy = nullptr;
+    curl_slist* headers = nullptr;
+    std::string url;
+    std::string unixSocket;
+    std::string body;
+    bool post = false;
+    std::chrono::milliseconds timeout{0};
+    const std::atomic<bool>* cancel = nullptr;
+    HttpResponse response;
+    std::promise<HttpResponse> promise;
+};
+
+class HttpClient::Impl
+{
+public:
+    Impl();
+    ~Impl();
+
+    std::future<HttpResponse> Submit(std::unique_ptr<Transfer> transfer);
+    void SetUnixSocketPath(const std::string& path);
+
+private:
+    void Run();
+    void Start(std::unique_ptr<Transfer> transfer);
+    void Finish(CURL* easy, CURLcode result);
+    void Fail(std::unique_ptr<Transfer> transfer, const std::string& error);
+
+    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
+    static int ProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                curl_off_t ultotal, curl_off_t ulnow);
+
+    CURLM* m_multi;
+    std::vector<CURL*> m_idleHandles;                  // Only touched by m_worker
+    std::vector<std::unique_ptr<Transfer>> m_active;   // Only touched by m_worker
+
+    std::mutex m_mutex;
+    std::deque<std::unique_ptr<Transfer>> m_incoming;
+    std::string m_unixSocket;
+    bool m_stopping;
+    std::thread m_worker;
+};
+
+HttpClient::Impl::Impl()
+    : m_multi(curl_multi_init()),
+      m_stopping(false)
+{
+    m_worker = std::thread(&Impl::Run, this);
+}
+
+HttpClient::Impl::~Impl()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    curl_multi_wakeup(m_multi);
+    m_worker.join();
+
+    for (CURL* easy : m_idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    curl_multi_cleanup(m_multi);
+}
+
+size_t HttpClient::Impl::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     size_t realsize = size * nmemb;
     std::string* response = static_cast<std::string*>(userp);
     response->append(static_cast<char*>(contents), realsize);
     return realsize;
 }
 
-wxString HttpClient::Get(const wxString& url) {
-    // Result string
-    std::string responseString;
-    
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        return "Error: Failed to initialize curl";
-    }
-    
-    // Convert wxString to std::string
-    std::string urlStr = url.ToStdString();
-    
-    // Set curl options
-    curl_easy_setopt(curl, CURLOPT_URL, urlStr.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 300L); // 10 seconds timeout
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L); // Follow redirects
-    
-    // Perform the request
-    CURLcode res = curl_easy_perform(curl);
-    
-    // Check for errors
-    if (res != CURLE_OK) {
-        wxString errorMsg = wxString::Format("Error: %s", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        return errorMsg;
-    }
-    
-    // Get HTTP response code
-    long httpCode = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-    
-    // Clean up
-    curl_easy_cleanup(curl);
-    
-    // Log the response code
-    wxLogDebug("HTTP GET request to %s completed with code %ld", url, httpCode);
-    
-    // Return the response
-    return wxString(responseString);
+int HttpClient::Impl::ProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                       curl_off_t ultotal, curl_off_t ulnow) {
+    const Transfer* transfer = static_cast<const Transfer*>(clientp);
+    // Any non-zero return makes curl fail with CURLE_ABORTED_BY_CALLBACK
+    return (transfer->cancel && transfer->cancel->load()) ? 1 : 0;
 }
 
-wxString HttpClient::Post(const wxString& url, const wxString& jsonData) {
-    // Result string
-    std::string responseString;
-    
-    std::cout << "DEBUG: HTTP POST starting to " << url.ToStdString() << std::endl;
-    std::cout << "DEBUG: JSON data size: " << jsonData.Length() << " characters" << std::endl;
-    
-    // Initialize curl
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cout << "DEBUG: Failed to initialize curl" << std::endl;
-        return "Error: Failed to initialize curl";
-    }
-    
-    std::cout << "DEBUG: curl initialized successfully" << std::endl;
-    
-    try {
-        // Convert wxString to std::string - potential crash point with large text
-        std::cout << "DEBUG: Converting URL to std::string" << std::endl;
-        std::string urlStr = url.ToStdString();
-        
-        std::cout << "DEBUG: Converting JSON data to std::string" << std::endl;
-        std::string dataStr = jsonData.ToStdString();
-        std::cout << "DEBUG: JSON data converted, size: " << dataStr.size() << " bytes" << std::endl;
-        
-        // Set up headers
-        std::cout << "DEBUG: Setting up headers" << std::endl;
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        headers = curl_slist_append(headers, "Accept: application/json");
-        
-        // Set curl options
-        std::cout << "DEBUG: Setting curl options" << std::endl;
-        curl_easy_setopt(curl, CURLOPT_URL, urlStr.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, dataStr.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 300L); // Increase timeout to 5 minutes (300 seconds)
-        
-        // Perform the request
-        std::cout << "DEBUG: Performing curl request" << std::endl;
-        CURLcode res = curl_easy_perform(curl);
-        std::cout << "DEBUG: curl request completed with code: " << res << std::endl;
-        
-        // Check for errors
-        if (res != CURLE_OK) {
-            std::cout << "DEBUG: curl error: " << curl_easy_strerror(res) << std::endl;
-            std::string errorStr = curl_easy_strerror(res);
-            curl_easy_cleanup(curl);
-            curl_slist_free_all(headers);
-            return wxString::Format("Error: %s", errorStr);
+std::future<HttpResponse> HttpClient::Impl::Submit(std::unique_ptr<Transfer> transfer)
+{
+    std::future<HttpResponse> future = transfer->promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            transfer->response.error = "HTTP client is shutting down";
+            transfer->promise.set_value(std::move(transfer->response));
+            return future;
         }
-        
-        // Get HTTP response code
-        long httpCode = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-        std::cout << "DEBUG: HTTP response code: " << httpCode << std::endl;
-        std::cout << "DEBUG: Response size: " << responseString.size() << " bytes" << std::endl;
-        
-        // Clean up
-        std::cout << "DEBUG: Cleaning up curl resources" << std::endl;
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
-        
-        std::cout << "DEBUG: HTTP POST completed successfully" << std::endl;
-        
-        // Return the response
-        return wxString(responseString);
-    }
-    catch (const std::exception& e) {
-        // Handle std::exception
-        std::cout << "DEBUG: Exception in HTTP POST: " << e.what() << std::endl;
-        try {
-            curl_easy_cleanup(curl);
-        } catch (...) {
-            std::cout << "DEBUG: Exception during curl cleanup" << std::endl;
+        transfer->unixSocket = m_unixSocket;
+        m_incoming.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(m_multi);
+    return future;
+}
+
+void HttpClient::Impl::SetUnixSocketPath(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unixSocket = path;
+}
+
+void HttpClient::Impl::Start(std::unique_ptr<Transfer> transfer)
+{
+    if (!m_idleHandles.empty()) {
+        transfer->easy = m_idleHandles.back();
+        m_idleHandles.pop_back();
+    } else {
+        transfer->easy = curl_easy_init();
+    }
+    if (!transfer->easy) {
+        Fail(std::move(transfer), "Failed to initialize curl");
+        return;
+    }
+
+    CURL* easy = transfer->easy;
+    curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response.body);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(transfer->timeout.count()));
+    if (!transfer->unixSocket.empty()) {
+        curl_easy_setopt(easy, CURLOPT_UNIX_SOCKET_PATH, transfer->unixSocket.c_str());
+    }
+    if (transfer->post) {
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->body.data());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(transfer->body.size()));
+    }
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+    curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+    curl_easy_setopt(easy, CURLOPT_XFERINFODATA, transfer.get());
+    if (transfer->headers) {
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    }
+
+    CURLMcode added = curl_multi_add_handle(m_multi, easy);
+    if (added != CURLM_OK) {
+        Fail(std::move(transfer), curl_multi_strerror(added));
+        return;
+    }
+    m_active.push_back(std::move(transfer));
+}
+
+void HttpClient::Impl::Finish(CURL* easy, CURLcode result)
+{
+    curl_multi_remove_handle(m_multi, easy);
+
+    auto it = m_active.begin();
+    while (it != m_active.end() && (*it)->easy != easy) {
+        ++it;
+    }
+    if (it == m_active.end()) {
+        curl_easy_cleanup(easy);
+        return;
+    }
+    std::unique_ptr<Transfer> transfer = std::move(*it);
+    m_active.erase(it);
+
+    if (result == CURLE_OK) {
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.statusCode);
+    } else {
+        transfer->response.cancelled = (result == CURLE_ABORTED_BY_CALLBACK);
+        transfer->response.error = curl_easy_strerror(result);
+    }
+    wxLogDebug("HTTP request to %s completed with code %ld", transfer->url, transfer->response.statusCode);
+
+    // Keep the handle (and its DNS/connection state) for the next request
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    transfer->easy = nullptr;
+    if (m_idleHandles.size() < MAX_IDLE_HANDLES) {
+        curl_easy_reset(easy);
+        m_idleHandles.push_back(easy);
+    } else {
+        curl_easy_cleanup(easy);
+    }
+
+    transfer->promise.set_value(std::move(transfer->response));
+}
+
+void HttpClient::Impl::Fail(std::unique_ptr<Transfer> transfer, const std::string& error)
+{
+    if (transfer->easy) {
+        curl_easy_cleanup(transfer->easy);
+    }
+    curl_slist_free_all(transfer->headers);
+    transfer->response.error = error;
+    transfer->promise.set_value(std::move(transfer->response));
+}
+
+void HttpClient::Impl::Run()
+{
+    while (true) {
+        // Pick up new requests
+        std::deque<std::unique_ptr<Transfer>> incoming;
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            incoming.swap(m_incoming);
+            stopping = m_stopping;
         }
-        return wxString::Format("Error during HTTP request: %s", e.what());
-    }
-    catch (...) {
-        // Handle unknown exceptions
-        std::cout << "DEBUG: Unknown exception in HTTP POST" << std::endl;
-        try {
-            curl_easy_cleanup(curl);
-        } catch (...) {
-            std::cout << "DEBUG: Exception during curl cleanup after unknown error" << std::endl;
+        for (auto& transfer : incoming) {
+            if (stopping) {
+                Fail(std::move(transfer), "HTTP client is shutting down");
+            } else {
+                Start(std::move(transfer));
+            }
         }
-        return "Unknown error during HTTP request";
+
+        if (stopping) {
+            break;
+        }
+
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg == CURLMSG_DONE) {
+                Finish(message->easy_handle, message->data.result);
+            }
+        }
+
+        // Sleep until there is socket activity, a new request, or a timer;
+        // the timeout bounds how long a cancel flag goes unnoticed
+        curl_multi_poll(m_multi, nullptr, 0, 100, nullptr);
+    }
+
+    // Abandon whatever is still running
+    while (!m_active.empty()) {
+        std::unique_ptr<Transfer> transfer = std::move(m_active.back());
+        m_active.pop_back();
+        curl_multi_remove_handle(m_multi, transfer->easy);
+        transfer->response.cancelled = true;
+        Fail(std::move(transfer), "HTTP client is shutting down");
+    }
+}
+
+HttpClient::HttpClient()
+    : m_impl(std::make_unique<Impl>())
+{
+}
+
+HttpClient::~HttpClient() = default;
+
+std::future<HttpResponse> HttpClient::GetAsync(std::string url, std::chrono::milliseconds timeout,
+                                               const std::atomic<bool>* cancel)
+{
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(url);
+    transfer->timeout = timeout;
+    transfer->cancel = cancel;
+    return m_impl->Submit(std::move(transfer));
+}
+
+std::future<HttpResponse> HttpClient::PostAsync(std::string url, std::string body,
+                                                const std::string& contentType,
+                                                std::chrono::milliseconds timeout,
+                                                const std::atomic<bool>* cancel)
+{
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(url);
+    transfer->body = std::move(body);
+    transfer->post = true;
+    transfer->timeout = timeout;
+    transfer->cancel = cancel;
+    transfer->headers = curl_slist_append(transfer->headers, ("Content-Type: " + contentType).c_str());
+    transfer->headers = curl_slist_append(transfer->headers, "Accept: application/json");
+    return m_impl->Submit(std::move(transfer));
+}
+
+void HttpClient::SetUnixSocketPath(const std::string& path)
+{
+    m_impl->SetUnixSocketPath(path);
+}
+
+HttpClient& HttpClient::Shared()
+{
+    static HttpClient client;
+    return client;
+}
+
+// Turn a response into the legacy string form: body on success, message on error
+static wxString LegacyResult(const HttpResponse& response)
+{
+    if (!response.error.empty()) {
+        return wxString::Format("Error: %s", response.error);
     }
-} 
\ No newline at end of file
+    return wxString::FromUTF8(response.body.data(), response.body.size());
+}
+
+wxString HttpClient::Get(const wxString& url) {
+    std::string urlStr(url.utf8_str());
+    return LegacyResult(Shared().GetAsync(std::move(urlStr), LEGACY_TIMEOUT).get());
+}
+
+wxString HttpClient::Post(const wxString& url, const wxString& jsonData) {
+    return Post(url, jsonData, nullptr);
+}
+
+wxString HttpClient::Post(const wxString& url, const wxString& jsonData, const std::atomic<bool>* cancel) {
+    std::string urlStr(url.utf8_str());
+    std::string body(jsonData.utf8_str());
+    return LegacyResult(Shared().PostAsync(std::move(urlStr), std::move(body), "application/json",
+                                           LEGACY_TIMEOUT, cancel).get());
+}
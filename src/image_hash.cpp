@@ -0,0 +1,266 @@
+#include "../include/image_hash.h"
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <vector>
+
+// XXH64 primes
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = RotateLeft(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+    acc ^= Round(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+uint64_t HashBytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        // Four independent accumulators keep the multipliers busy in parallel
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const unsigned char* limit = end - 32;
+
+        do {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = seed + PRIME5;
+    }
+
+    hash += static_cast<uint64_t>(length);
+
+    // Tail
+    while (p + 8 <= end) {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+        hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= (*p) * PRIME5;
+        hash = RotateLeft(hash, 11) * PRIME1;
+        ++p;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Shared by both overloads, so a wxImage and a PixelBuffer holding the same
+// pixels hash alike
+static uint64_t HashPixels(const unsigned char* rgb, const unsigned char* alpha, int width, int height) {
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    // Seed with the dimensions so a reshaped buffer doesn't collide
+    uint64_t seed = (static_cast<uint64_t>(width) << 32) | static_cast<uint32_t>(height);
+    uint64_t hash = HashBytes(rgb, pixelCount * 3, seed);
+
+    if (alpha) {
+        hash = HashBytes(alpha, pixelCount, hash);
+    }
+    return hash;
+}
+
+uint64_t HashImagePixels(const wxImage& image) {
+    if (!image.IsOk()) {
+        return 0;
+    }
+    return HashPixels(image.GetData(), image.HasAlpha() ? image.GetAlpha() : nullptr,
+                      image.GetWidth(), image.GetHeight());
+}
+
+uint64_t HashImagePixels(const PixelBuffer& pixels) {
+    if (!pixels.IsOk()) {
+        return 0;
+    }
+    return HashPixels(pixels.GetData(), pixels.GetAlpha(), pixels.GetWidth(), pixels.GetHeight());
+}
+
+// Grid of the perceptual hash: GRID_WIDTH + 1 columns give GRID_WIDTH
+// comparisons per row
+static const int GRID_WIDTH = 16;
+static const int GRID_HEIGHT = 16;
+
+// Luminance spread below which an edge row or column counts as uniform
+static const int UNIFORM_TOLERANCE = 16;
+
+static inline int Luminance(const unsigned char* pixel) {
+    return (pixel[0] * 77 + pixel[1] * 150 + pixel[2] * 29) >> 8;
+}
+
+PerceptualHash ComputePerceptualHash(const unsigned char* rgb, int width, int height) {
+    PerceptualHash hash;
+    if (!rgb || width <= 0 || height <= 0) {
+        return hash;
+    }
+
+    std::vector<unsigned char> gray(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < gray.size(); ++i) {
+        gray[i] = static_cast<unsigned char>(Luminance(rgb + i * 3));
+    }
+
+    auto rowUniform = [&](int y, int left, int right) {
+        const unsigned char* row = gray.data() + static_cast<size_t>(y) * width;
+        auto range = std::minmax_element(row + left, row + right);
+        return *range.second - *range.first <= UNIFORM_TOLERANCE;
+    };
+    auto columnUniform = [&](int x, int top, int bottom) {
+        int low = 255;
+        int high = 0;
+        for (int y = top; y < bottom; ++y) {
+            int value = gray[static_cast<size_t>(y) * width + x];
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+        return high - low <= UNIFORM_TOLERANCE;
+    };
+
+    // Trim uniform edges until every edge has some content
+    int left = 0;
+    int right = width;
+    int top = 0;
+    int bottom = height;
+    bool trimmed = true;
+    while (trimmed) {
+        trimmed = false;
+        while (top < bottom && rowUniform(top, left, right)) {
+            ++top;
+            trimmed = true;
+        }
+        while (bottom > top && rowUniform(bottom - 1, left, right)) {
+            --bottom;
+            trimmed = true;
+        }
+        if (top == bottom) {
+            break;
+        }
+        while (left < right && columnUniform(left, top, bottom)) {
+            ++left;
+            trimmed = true;
+        }
+        while (right > left && columnUniform(right - 1, top, bottom)) {
+            --right;
+            trimmed = true;
+        }
+        if (left == right) {
+            break;
+        }
+    }
+    if (right - left < 2 || bottom - top < 2) {
+        return hash;
+    }
+
+    // Average the content into the grid
+    const int columns = GRID_WIDTH + 1;
+    std::vector<uint64_t> sums(static_cast<size_t>(columns) * GRID_HEIGHT, 0);
+    std::vector<uint32_t> counts(sums.size(), 0);
+    const int contentWidth = right - left;
+    const int contentHeight = bottom - top;
+    for (int y = top; y < bottom; ++y) {
+        int cellY = static_cast<int>(static_cast<int64_t>(y - top) * GRID_HEIGHT / contentHeight);
+        const unsigned char* row = gray.data() + static_cast<size_t>(y) * width;
+        for (int x = left; x < right; ++x) {
+            int cellX = static_cast<int>(static_cast<int64_t>(x - left) * columns / contentWidth);
+            size_t cell = static_cast<size_t>(cellY) * columns + cellX;
+            sums[cell] += row[x];
+            ++counts[cell];
+        }
+    }
+
+    // Cells of very narrow content may be empty; treat them as white
+    auto average = [&](int cellX, int cellY) {
+        size_t cell = static_cast<size_t>(cellY) * columns + cellX;
+        return counts[cell] ? static_cast<double>(sums[cell]) / counts[cell] : 255.0;
+    };
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            if (average(x, y) < average(x + 1, y)) {
+                int bit = y * GRID_WIDTH + x;
+                hash.bits[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+        }
+    }
+
+    // Exact hash of the content, seeded with its size like HashPixels
+    uint64_t content = (static_cast<uint64_t>(contentWidth) << 32) | static_cast<uint32_t>(contentHeight);
+    for (int y = top; y < bottom; ++y) {
+        content = HashBytes(rgb + (static_cast<size_t>(y) * width + left) * 3,
+                            static_cast<size_t>(contentWidth) * 3, content);
+    }
+    hash.content = content;
+    hash.width = contentWidth;
+    hash.height = contentHeight;
+    return hash;
+}
+
+PerceptualHash ComputePerceptualHash(const wxImage& image) {
+    if (!image.IsOk()) {
+        return PerceptualHash();
+    }
+    return ComputePerceptualHash(image.GetData(), image.GetWidth(), image.GetHeight());
+}
+
+PerceptualHash ComputePerceptualHash(const PixelBuffer& pixels) {
+    if (!pixels.IsOk()) {
+        return PerceptualHash();
+    }
+    return ComputePerceptualHash(pixels.GetData(), pixels.GetWidth(), pixels.GetHeight());
+}
+
+int HammingDistance(const PerceptualHash& a, const PerceptualHash& b) {
+    int distance = 0;
+    for (int i = 0; i < 4; ++i) {
+        distance += static_cast<int>(std::bitset<64>(a.bits[i] ^ b.bits[i]).count());
+    }
+    return distance;
+}
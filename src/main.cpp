@@ -1,5 +1,6 @@
 #include <wx/wx.h>
 #include "../include/main_frame.h"
+#include "../include/startup_trace.h"
 
 // The main application class.
 class MyApp : public wxApp
@@ -7,9 +8,17 @@ class MyApp : public wxApp
 public:
     virtual bool OnInit() override
     {
+        StartupTrace::Mark("app init");
         wxLog::SetLogLevel(wxLOG_Info);  // Only show Info level and above (hides Debug)
+        
+        // Needed for PNG icons and clipboard images; done once for the app
+        wxInitAllImageHandlers();
+        StartupTrace::Mark("image handlers");
+        
         MainFrame* frame = new MainFrame();
+        StartupTrace::Mark("main frame created");
         frame->Show(true);
+        StartupTrace::Mark("main frame shown");
         return true;
     }
 };
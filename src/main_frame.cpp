@@ -4,6 +4,7 @@
 #include <nlohmann/json.hpp>
 #include <wx/sound.h>
 #include "../include/base64.h"
+#include "../include/startup_trace.h"
 #include <fstream>
 #include <wx/stdpaths.h>
 #include <wx/filename.h>
@@ -18,40 +19,60 @@ bool TooMuchText(const wxString& text) {
     }
     return false;
 }
-bool IsServerOnline() {
-    try {
-        wxString response = HttpClient::Get("http://localhost:8080/health");
-        return response.Contains("ok") || response.Contains("OK");
-    } catch (...) {
-        return false;
-    }
+// Backend location. HANSNAP_BACKEND_URL overrides the base URL; setting
+// HANSNAP_BACKEND_SOCKET sends requests over that Unix domain socket instead
+// of TCP (the base URL then only supplies the Host header).
+std::string BackendUrl(const std::string& path) {
+    static const std::string baseUrl = []() {
+        wxString url;
+        if (!wxGetEnv("HANSNAP_BACKEND_URL", &url) || url.IsEmpty()) {
+            url = "http://localhost:8080";
+        }
+        if (url.EndsWith("/")) {
+            url.RemoveLast();
+        }
+        wxString socketPath;
+        if (wxGetEnv("HANSNAP_BACKEND_SOCKET", &socketPath) && !socketPath.IsEmpty()) {
+            HttpClient::Shared().SetUnixSocketPath(std::string(socketPath.utf8_str()));
+        }
+        return std::string(url.utf8_str());
+    }();
+    return baseUrl + path;
 }
 
-json GetLLMResponse(const wxString& text) {
+// Server probe timing: each attempt may take SERVER_PROBE_TIMEOUT, failed
+// attempts are retried after a delay that doubles up to the maximum
+const std::chrono::milliseconds SERVER_PROBE_TIMEOUT(2000);
+const int SERVER_PROBE_POLL_MS = 100;
+const int SERVER_RETRY_INITIAL_MS = 500;
+const int SERVER_RETRY_MAX_MS = 30000;
+const int SERVER_OFFLINE_WARNING_ATTEMPTS = 5;  // Warn the user once after this many failures
 
-    // Escape any special characters in the recognized text
-    wxString escapedText = text;
-    escapedText.Replace("\\", "\\\\");
-    escapedText.Replace("\"", "\\\"");
-    escapedText.Replace("\n", "\\n");
-    escapedText.Replace("\r", "\\r");
-    escapedText.Replace("\t", "\\t");
-    
-    wxString jsonStr = "{\"text\": \"" + escapedText + "\"}";
-    wxString response = HttpClient::Post("http://localhost:8080/llm", jsonStr);
+const char* CONNECTING_STATUS = "Connecting to server...";
+const char* OFFLINE_STATUS = "Server is offline, retrying...";
+
+json GetLLMResponse(const wxString& text, const std::atomic<bool>& cancelled) {
+
+    std::string body = json{{"text", std::string(text.utf8_str())}}.dump();
+    HttpResponse response = HttpClient::Shared().PostAsync(
+        BackendUrl("/llm"), std::move(body), "application/json",
+        std::chrono::minutes(5), &cancelled).get();
 
     // check if response is ok
-    if (response.Contains("error")) {
-        std::cout << "Error: " << response << std::endl;
+    if (!response.Ok()) {
+        std::cout << "Error: " << (response.error.empty() ? "HTTP " + std::to_string(response.statusCode) : response.error) << std::endl;
         return json::parse("{\"error\": \"Failed to get response from LLM\"}");
     }
-    
-    return json::parse(response);
+
+    return json::parse(response.body);
 }
 
 MainFrame::MainFrame()
     : wxFrame(nullptr, wxID_ANY, "HanSnap - Chinese Translation", wxDefaultPosition, wxSize(800, 600)),
-      m_lastProcessedTimestamp(wxDateTime::Now())  // Initialize with current time
+      m_lastProcessedTimestamp(wxDateTime::Now()),  // Initialize with current time
+      m_serverProbeTimer(this),
+      m_serverProbeAttempts(0),
+      m_ocrPreloadStop(false)
 {
 
 
@@ -79,12 +100,6 @@ MainFrame::MainFrame()
     
     waitingSizer->Add(m_waitingMessage, 0, wxALIGN_CENTER | wxALL, 20);
     
-    // First check if server is online
-    if (!IsServerOnline()) {
-        wxMessageBox("Server is offline. Please start the server and try again.", "Error", wxOK | wxICON_ERROR);
-        exit(1);
-    }
-
     // Add a helpful instruction message
     wxStaticText* instructionText = new wxStaticText(m_waitingPanel, wxID_ANY, 
         "Copy Chinese text or an image containing Chinese text to translate it automatically.",
@@ -248,11 +263,46 @@ MainFrame::MainFrame()
     
     // Create taskbar icon
     m_taskBarIcon = new MyTaskBarIcon(this);
+    LoadTaskBarIcon();
+    StartupTrace::Mark("widgets created");
     
     // Bind events
     Bind(wxEVT_CLOSE_WINDOW, &MainFrame::OnClose, this);
     Bind(wxEVT_COMMAND_MENU_SELECTED, &MainFrame::OnToggleApp, this, MyTaskBarIcon::ID_TOGGLE_APP);
     
+    // Earlier translations are shown from a local cache, even with the
+    // server down. Set HANSNAP_REVALIDATE_CACHE=1 to refresh them too.
+    m_cache = std::make_unique<TranslationCache>(TranslationCache::DefaultPath());
+    wxString revalidate;
+    m_revalidateCached = wxGetEnv("HANSNAP_REVALIDATE_CACHE", &revalidate) && revalidate == "1";
+    
+    // Images recognized before skip OCR. HANSNAP_OCR_CACHE=memory keeps the
+    // results for this session only, HANSNAP_OCR_CACHE=0 disables the cache.
+    wxString ocrCache;
+    wxGetEnv("HANSNAP_OCR_CACHE", &ocrCache);
+    if (ocrCache == "memory") {
+        m_ocrCache = std::make_unique<OcrCache>();
+    } else if (ocrCache != "0") {
+        m_ocrCache = std::make_unique<OcrCache>(OcrCache::DefaultPath());
+    }
+    
+    // OCR and translation run on a worker thread; results come back here
+    m_pipeline = std::make_unique<TranslationPipeline>(
+        this,
+        GetLLMResponse,
+        [this](const TranslationResult& result) { OnTranslationResult(result); },
+        MAX_TEXT_LENGTH,
+        m_cache.get(),
+        m_ocrCache.get());
+    
+    // Images without signs of text skip OCR. HANSNAP_OCR_TEXT_THRESHOLD sets
+    // how many cells of text evidence an image needs (0 disables the check).
+    wxString textThreshold;
+    unsigned long minTextCells = 0;
+    if (wxGetEnv("HANSNAP_OCR_TEXT_THRESHOLD", &textThreshold) && textThreshold.ToULong(&minTextCells)) {
+        m_pipeline->SetTextThreshold(minTextCells);
+    }
+    
     // Initialize clipboard processor with callbacks that include timestamps
     m_clipboardProcessor = std::make_unique<ClipboardProcessor>();
     m_clipboardProcessor->Initialize(
@@ -263,7 +313,7 @@ MainFrame::MainFrame()
                 m_lastProcessedTimestamp = timestamp;
             }
         },
-        [this](const wxBitmap& image, const wxDateTime& timestamp) {
+        [this](const PixelBuffer& image, const wxDateTime& timestamp) {
             // Only process if timestamp is newer than last processed timestamp
             if (timestamp > m_lastProcessedTimestamp) {
                 OnClipboardImage(image, timestamp);
@@ -272,28 +322,204 @@ MainFrame::MainFrame()
         }
     );
     
+    // Only the last of several quick copies is translated. Set
+    // HANSNAP_CLIPBOARD_SETTLE_MS to change the window (0 disables it).
+    wxString settleMs;
+    long settle = 0;
+    if (wxGetEnv("HANSNAP_CLIPBOARD_SETTLE_MS", &settleMs) && settleMs.ToLong(&settle)) {
+        m_clipboardProcessor->SetSettleInterval(static_cast<int>(settle));
+    }
+    
     // Start monitoring clipboard
     m_clipboardProcessor->Start();
     
+    StartupTrace::Mark("clipboard monitoring started");
+    
     // Center the window
     Centre();
+    
+    // Start with waiting message
+    ShowWaitingMessage();
+    
+    // Don't hold up the window for the server or for Tesseract: probe the
+    // server in the background and load the OCR data on a worker thread so
+    // the first copied image doesn't pay for it
+    Bind(wxEVT_TIMER, &MainFrame::OnServerProbeTimer, this, m_serverProbeTimer.GetId());
+    SetStatusText(CONNECTING_STATUS);
+    StartServerProbe();
+    
+    // The OCR data stays loaded between images. Set
+    // HANSNAP_OCR_IDLE_UNLOAD_SECS to free it after that long without use.
+    wxString idleUnload;
+    long idleSeconds = 0;
+    if (wxGetEnv("HANSNAP_OCR_IDLE_UNLOAD_SECS", &idleUnload) && idleUnload.ToLong(&idleSeconds) && idleSeconds > 0) {
+        OcrEngine::SetIdleUnloadTimeout(std::chrono::seconds(idleSeconds));
+    }
+    
+    // Images are recognized on a pool of engines, half the cores by
+    // default. HANSNAP_OCR_THREADS overrides the size.
+    wxString ocrThreads;
+    long threads = 0;
+    if (wxGetEnv("HANSNAP_OCR_THREADS", &ocrThreads) && ocrThreads.ToLong(&threads) && threads > 0) {
+        OcrEngine::SetPoolSize(static_cast<size_t>(threads));
+    }
+    
+    // Preprocessing: HANSNAP_OCR_DESKEW=1 straightens slightly rotated
+    // images, HANSNAP_OCR_BINARIZE picks sauvola (default), otsu or none
+    OcrPreprocess::Options preprocess;
+    wxString deskew, binarize;
+    preprocess.deskew = wxGetEnv("HANSNAP_OCR_DESKEW", &deskew) && deskew == "1";
+    if (wxGetEnv("HANSNAP_OCR_BINARIZE", &binarize)) {
+        if (binarize == "otsu") {
+            preprocess.binarization = OcrPreprocess::Binarization::Otsu;
+        } else if (binarize == "none") {
+            preprocess.binarization = OcrPreprocess::Binarization::None;
+        }
+    }
+    OcrEngine::SetPreprocessOptions(preprocess);
+    
+    // Only areas found to contain text lines are recognized;
+    // HANSNAP_OCR_REGIONS=0 recognizes whole images instead
+    wxString regions;
+    if (wxGetEnv("HANSNAP_OCR_REGIONS", &regions) && regions == "0") {
+        OcrEngine::SetRegionDetection(false);
+    }
+    
+    // A few lines are read with both Chinese models to pick one for the
+    // rest of the image; HANSNAP_OCR_SCRIPT_DETECT=0 always uses both
+    wxString scriptDetect;
+    if (wxGetEnv("HANSNAP_OCR_SCRIPT_DETECT", &scriptDetect) && scriptDetect == "0") {
+        OcrEngine::SetScriptDetection(false);
+    }
+    
+    // Models: HANSNAP_TESSDATA_FAST and HANSNAP_TESSDATA_BEST point at the
+    // tessdata_fast and tessdata_best directories. With fast models the
+    // default is to read with them and re-read low-confidence lines
+    // (below HANSNAP_OCR_ESCALATE_CONF, 70 by default) with the best ones.
+    // HANSNAP_OCR_PROFILE=fast, accurate or auto overrides the choice.
+    wxString fastModels, bestModels, profile, escalateConf;
+    wxGetEnv("HANSNAP_TESSDATA_FAST", &fastModels);
+    wxGetEnv("HANSNAP_TESSDATA_BEST", &bestModels);
+    OcrEngine::SetModelPaths(std::string(fastModels.utf8_str()), std::string(bestModels.utf8_str()));
+    OcrEngine::Profile ocrProfile = fastModels.IsEmpty() ? OcrEngine::Profile::Accurate : OcrEngine::Profile::Auto;
+    if (wxGetEnv("HANSNAP_OCR_PROFILE", &profile)) {
+        if (profile == "fast") {
+            ocrProfile = OcrEngine::Profile::Fast;
+        } else if (profile == "accurate") {
+            ocrProfile = OcrEngine::Profile::Accurate;
+        } else if (profile == "auto") {
+            ocrProfile = OcrEngine::Profile::Auto;
+        }
+    }
+    OcrEngine::SetProfile(ocrProfile);
+    double confidence = 0;
+    if (wxGetEnv("HANSNAP_OCR_ESCALATE_CONF", &escalateConf) && escalateConf.ToDouble(&confidence)) {
+        OcrEngine::SetEscalationThreshold(static_cast<float>(confidence));
+    }
+    
+    m_ocrPreload = std::thread([this]() {
+        if (OcrEngine::Warmup("chi_sim+chi_tra", &m_ocrPreloadStop)) {
+            StartupTrace::Mark("OCR engine loaded");
+        } else {
+            StartupTrace::Mark("OCR engine failed to load");
+        }
+    });
+}
 
-    // Create and setup taskbar icon
-    m_taskBarIcon = new MyTaskBarIcon(this);
+void MainFrame::LoadTaskBarIcon()
+{
+    // Look next to the executable (and one level up for build directories),
+    // falling back to the working directory
+    wxFileName exeDir(wxStandardPaths::Get().GetExecutablePath());
+    wxString candidates[] = {
+        wxFileName(exeDir.GetPath(), "assets/images/app_icon.png").GetFullPath(),
+        wxFileName(exeDir.GetPath() + "/..", "assets/images/app_icon.png").GetFullPath(),
+        wxFileName(wxStandardPaths::Get().GetResourcesDir(), "app_icon.png").GetFullPath(),
+        "assets/images/app_icon.png",
+        "../assets/images/app_icon.png"
+    };
+    
+    for (const wxString& path : candidates) {
+        wxIcon icon;
+        if (wxFileExists(path) && icon.LoadFile(path, wxBITMAP_TYPE_PNG)) {
+            m_taskBarIcon->SetIcon(icon, "HanSnap - Chinese Translation");
+            return;
+        }
+    }
+    wxLogDebug("Taskbar icon not found next to %s", exeDir.GetFullPath());
+}
+
+void MainFrame::StartServerProbe()
+{
+    m_serverProbe = HttpClient::Shared().GetAsync(BackendUrl("/health"), SERVER_PROBE_TIMEOUT);
+    m_serverProbeTimer.Start(SERVER_PROBE_POLL_MS);
+}
+
+void MainFrame::OnServerProbeTimer(wxTimerEvent& WXUNUSED(event))
+{
+    // A retry delay has passed
+    if (!m_serverProbe.valid()) {
+        StartServerProbe();
+        return;
+    }
     
-    // Load an icon file
-    wxIcon icon;
-    if (icon.LoadFile("../assets/images/app_icon.png", wxBITMAP_TYPE_PNG)) {
-        m_taskBarIcon->SetIcon(icon, "HanSnap - Chinese Translation");
+    if (m_serverProbe.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
     }
     
+    HttpResponse response = m_serverProbe.get();
+    wxString body = wxString::FromUTF8(response.body.data(), response.body.size());
+    if (response.Ok() && (body.Contains("ok") || body.Contains("OK"))) {
+        m_serverProbeTimer.Stop();
+        StartupTrace::Mark("server online");
+        
+        // Leave the status alone if a translation has replaced it meanwhile
+        wxString status = GetStatusBar()->GetStatusText();
+        if (status == CONNECTING_STATUS || status == OFFLINE_STATUS) {
+            SetStatusText("Waiting for clipboard content...");
+        }
+        return;
+    }
     
-    // Start with waiting message
-    ShowWaitingMessage();
+    ++m_serverProbeAttempts;
+    std::cout << "Server probe " << m_serverProbeAttempts << " failed: "
+              << (response.error.empty() ? "HTTP " + std::to_string(response.statusCode) : response.error)
+              << std::endl;
+    SetStatusText(OFFLINE_STATUS);
+    if (m_serverProbeAttempts == SERVER_OFFLINE_WARNING_ATTEMPTS) {
+        ShowWarning("Server is offline. Translations will resume once it is started.");
+    }
+    
+    int delayMs = SERVER_RETRY_INITIAL_MS << std::min(m_serverProbeAttempts - 1, 10);
+    m_serverProbeTimer.StartOnce(std::min(delayMs, SERVER_RETRY_MAX_MS));
 }
 
 MainFrame::~MainFrame()
 {
+    if (m_clipboardProcessor) {
+        ClipboardDispatchStats stats = m_clipboardProcessor->GetDispatchStats();
+        std::cout << "Clipboard changes dispatched: " << stats.dispatched
+                  << ", suppressed in bursts: " << stats.suppressed << std::endl;
+    }
+    if (m_ocrCache) {
+        OcrCache::Stats stats = m_ocrCache->GetStats();
+        std::cout << "OCR cache hits: " << stats.exactHits << " exact, " << stats.nearHits
+                  << " near-duplicate; misses: " << stats.misses << std::endl;
+    }
+    if (m_pipeline) {
+        std::cout << "Images rejected as not text: " << m_pipeline->GetRejectedImages() << std::endl;
+    }
+    
+    m_serverProbeTimer.Stop();
+    
+    // Stop the workers before the OCR engine they use goes away. A warmup
+    // still loading the pool stops after the instance it is on.
+    m_ocrPreloadStop = true;
+    if (m_ocrPreload.joinable()) {
+        m_ocrPreload.join();
+    }
+    m_pipeline.reset();
+    
     // Clean up OCR engine to prevent memory leaks
     OcrEngine::Cleanup();
     
@@ -314,6 +540,7 @@ MainFrame::~MainFrame()
 void MainFrame::ShowWaitingMessage()
 {
     // Show waiting message and hide translation UI
+    m_waitingMessage->SetLabel("Waiting for Clipboard Content...");
     m_waitingPanel->Show();
     m_translationPanel->Hide();
     
@@ -442,8 +669,9 @@ void MainFrame::OnToggleApp(wxCommandEvent& event)
         Raise();
     } else {
         // We're turning the app off
-        // Stop clipboard monitoring
+        // Stop clipboard monitoring and abandon any translation in progress
         m_clipboardProcessor->Stop();
+        m_pipeline->Cancel();
         
         // Hide the window
         Hide();
@@ -464,57 +692,79 @@ void MainFrame::OnClose(wxCloseEvent& event)
 void MainFrame::OnClipboardText(const wxString& text, const wxDateTime& timestamp)
 {
     if (TooMuchText(text)) {
+        m_pipeline->Cancel();
         ShowError("Exceeded the maximum text length of " + wxString::Format("%d", MAX_TEXT_LENGTH) + " characters.", "Error");
         return;
     }
-    std::cout << "GETTING LLM RESPONSE" << std::endl;
     
+    // Show a cached translation right away, without waiting for the worker
+    json cached;
+    if (m_cache->Lookup(text, cached)) {
+        m_pipeline->Cancel();
+        UpdateUIWithTranslation(cached);
+        SetStatusText("Translation completed (cached)");
+        if (m_revalidateCached) {
+            m_pipeline->SubmitText(text, true);
+        }
+        return;
+    }
+    std::cout << "GETTING LLM RESPONSE" << std::endl;
     
-    // while wating for LLM response, change the waiting message to "Translating..."
+    // Supersedes any translation still in flight
     ShowTranslating();
-    
-    json response = GetLLMResponse(text);
-    
-    UpdateUIWithTranslation(response);
-    RequestUserAttention(wxUSER_ATTENTION_INFO);
+    m_pipeline->SubmitText(text);
 }
 
-void MainFrame::OnClipboardImage(const wxBitmap& image, const wxDateTime& timestamp)
+void MainFrame::OnClipboardImage(const PixelBuffer& image, const wxDateTime& timestamp)
 {
-    // Show the image preview
-    // m_imageDisplay->SetBitmap(image);
-    // m_imageDisplay->Show();
-    // Initialize OCR for Chinese
-    if (!OcrEngine::IsInitialized()) {
-        if (!OcrEngine::Initialize("chi_sim+chi_tra")) {
-            wxLogError("Failed to initialize OCR engine for Chinese");
-        }
+    // The clipboard reader already copied the pixels out of the bitmap on
+    // this thread; the pipeline shares that buffer
+    ShowTranslating();
+    m_pipeline->SubmitImage(image);
+}
+
+void MainFrame::OnTranslationResult(const TranslationResult& result)
+{
+    // A failed refresh leaves the cached translation on screen
+    if (result.revalidation && result.status != TranslationResult::Status::Translated) {
+        return;
     }
     
-    // Perform OCR on the image
-    if (OcrEngine::IsInitialized()) {
-        wxString recognizedText = OcrEngine::ExtractTextFromBitmap(image);
-        if (TooMuchText(recognizedText)) {
-            ShowError("Exceeded the maximum text length of " + wxString::Format("%d", MAX_TEXT_LENGTH) + " characters.", "Error");
-            return;
-        }
-        if (!recognizedText.IsEmpty()) {
-            ShowTranslating();
-            json response = GetLLMResponse(recognizedText);
-            std::cout << "Response: " << response << std::endl;
-            UpdateUIWithTranslation(response);
-            RequestUserAttention(wxUSER_ATTENTION_INFO);
-        } else {
-            // No text recognized
+    switch (result.status) {
+        case TranslationResult::Status::Translated:
+            std::cout << "Response: " << result.response << std::endl;
+            UpdateUIWithTranslation(result.response);
+            if (result.fromCache) {
+                SetStatusText("Translation completed (cached)");
+            }
+            if (!result.revalidation) {
+                RequestUserAttention(wxUSER_ATTENTION_INFO);
+            }
+            break;
+            
+        case TranslationResult::Status::NoText:
             ShowWaitingMessage();
             wxMessageBox("No text was recognized in the image.", "OCR Result", 
                         wxOK | wxICON_INFORMATION);
-        }
+            break;
+            
+        case TranslationResult::Status::NotText:
+            // Copied photos and drawings are common; don't interrupt with a dialog
+            ShowWaitingMessage();
+            SetStatusText("Copied image doesn't appear to contain text");
+            break;
+            
+        case TranslationResult::Status::TooMuchText:
+            ShowWaitingMessage();
+            ShowError("Exceeded the maximum text length of " + wxString::Format("%d", MAX_TEXT_LENGTH) + " characters.", "Error");
+            break;
+            
+        case TranslationResult::Status::Failed:
+            ShowWaitingMessage();
+            ShowError(result.error, "Error");
+            break;
     }
-    
-    // Update layout
-    // m_mainPanel->Layout();
-} 
+}
 
 
 
@@ -527,9 +777,10 @@ void MainFrame::ShowWarning(const wxString& message) {
 }
 
 void MainFrame::ShowTranslating() {
+    // The work happens on the pipeline thread, so no need to yield here
     m_waitingMessage->SetLabel("Translating...");
+    SetStatusText("Translating...");
     m_mainPanel->Layout();
-    wxYield();
 }
 
 void MainFrame::OnPlayMandarin(wxCommandEvent& event)
@@ -1,158 +1,1074 @@
 #include "../include/ocr.h"
+#include "../include/script_detect.h"
 #include <tesseract/baseapi.h>
+#include <tesseract/ocrclass.h>
+#include <tesseract/resultiterator.h>
 #include <leptonica/allheaders.h>
 #include <wx/mstream.h>
 #include <wx/filename.h>
 #include <wx/log.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using tesseract::TessBaseAPI;
 
 // Initialize static members
-void* OcrEngine::m_tessApi = nullptr;
-bool OcrEngine::m_initialized = false;
+std::atomic<bool> OcrEngine::m_initialized(false);
 
-bool OcrEngine::Initialize(const std::string& language) {
-    // Clean up any existing instance
-    Cleanup();
-    
+// Engine pool. Instances are created on demand up to s_poolSize and handed
+// out one request at a time, since TessBaseAPI is not thread safe. Instances
+// may hold different language sets (the configured one, or a single-script
+// subset of it) and profiles. A full pool reuses what is loaded where it can
+// (see CheckoutApi) rather than reload models for every image.
+struct PooledApi {
+    TessBaseAPI* api;
+    uint64_t generation;  // Instances from an older generation are discarded on return
+    std::string language;
+    OcrEngine::Profile profile;
+};
+
+static std::mutex s_poolMutex;
+static std::condition_variable s_poolAvailable;
+static std::vector<PooledApi> s_idleApis;
+static size_t s_createdApis = 0;
+static size_t s_poolSize = std::max(1u, std::thread::hardware_concurrency() / 2);
+static uint64_t s_poolGeneration = 0;
+static std::string s_language;
+static std::chrono::milliseconds s_checkoutTimeout(30000);
+static OcrPreprocess::Options s_preprocessOptions;
+static bool s_regionDetection = true;
+static bool s_scriptDetection = true;
+static OcrEngine::Profile s_profile = OcrEngine::Profile::Accurate;
+static std::string s_fastDataPath;      // Empty for Tesseract's default tessdata
+static std::string s_accurateDataPath;
+static float s_escalationThreshold = 70.0f;
+
+// Text lines read with both scripts' models before choosing one
+static const int SCRIPT_SAMPLE_LINES = 6;
+
+// Timings of the last recognition
+static std::mutex s_timingsMutex;
+static OcrTimings s_lastTimings;
+
+// Serializes first-time initialization
+static std::mutex s_initMutex;
+
+// Time of the last OCR request, in steady_clock ticks
+static std::atomic<std::chrono::steady_clock::rep> s_lastUsed(0);
+
+// Idle unload thread
+static std::mutex s_idleMutex;
+static std::condition_variable s_idleChanged;
+static std::chrono::seconds s_idleTimeout(0);
+static bool s_idleStop = false;
+static std::thread s_idleThread;
+
+static void MarkUsed() {
+    s_lastUsed = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+// How an instance of each profile is loaded and run
+struct ProfileSettings {
+    tesseract::OcrEngineMode engineMode;
+    tesseract::PageSegMode pageSegMode;
+};
+
+static ProfileSettings SettingsFor(OcrEngine::Profile profile) {
+    if (profile == OcrEngine::Profile::Fast) {
+        // Regions are already separated, so each can be read as one block
+        return ProfileSettings{tesseract::OEM_LSTM_ONLY, tesseract::PSM_SINGLE_BLOCK};
+    }
+    return ProfileSettings{tesseract::OEM_DEFAULT, tesseract::PSM_AUTO};
+}
+
+// Profile used for the first reading of every image
+static OcrEngine::Profile FirstPassProfile(OcrEngine::Profile profile) {
+    return profile == OcrEngine::Profile::Accurate ? profile : OcrEngine::Profile::Fast;
+}
+
+static TessBaseAPI* CreateApi(const std::string& language, const std::string& dataPath,
+                              OcrEngine::Profile profile) {
     // Create a new Tesseract instance
-    tesseract::TessBaseAPI* api = new tesseract::TessBaseAPI();
+    TessBaseAPI* api = new TessBaseAPI();
     
     // Initialize Tesseract with language data
-    int result = api->Init(nullptr, language.c_str());
+    ProfileSettings settings = SettingsFor(profile);
+    int result = api->Init(dataPath.empty() ? nullptr : dataPath.c_str(), language.c_str(),
+                           settings.engineMode);
     if (result != 0) {
         wxLogError("Failed to initialize Tesseract OCR engine");
         delete api;
-        return false;
+        return nullptr;
+    }
+    
+    // Settings shared by every recognition
+    api->SetPageSegMode(settings.pageSegMode);
+    return api;
+}
+
+static void DestroyApi(TessBaseAPI* api) {
+    api->End();
+    delete api;
+}
+
+// Take the idle instances out of the pool; the caller destroys them
+// outside the lock. Requires s_poolMutex.
+static std::vector<PooledApi> TakeIdleApis() {
+    std::vector<PooledApi> idle;
+    idle.swap(s_idleApis);
+    s_createdApis -= idle.size();
+    return idle;
+}
+
+static void DestroyApis(const std::vector<PooledApi>& apis) {
+    for (const PooledApi& pooled : apis) {
+        DestroyApi(pooled.api);
+    }
+}
+
+// What CheckoutApi does when the pool is full and no idle instance of the
+// requested kind is free
+enum class Checkout {
+    Replace,   // Replace an idle instance of another kind
+    Existing,  // Return nothing; for optional work such as escalation
+};
+
+// Borrow an instance with the given language set (the configured one if
+// empty) and profile from the pool, creating one if the pool isn't full.
+// When it is full, a single-script request takes an idle instance with the
+// configured set instead, which reads both scripts; otherwise the mode
+// decides. Returns a null api if none became free within the wait or
+// creation failed.
+static PooledApi CheckoutApi(std::chrono::milliseconds wait, const std::string& requested,
+                             OcrEngine::Profile profile, Checkout mode = Checkout::Replace) {
+    std::unique_lock<std::mutex> lock(s_poolMutex);
+    MarkUsed();
+    bool ready = s_poolAvailable.wait_for(lock, wait, []() {
+        return !s_idleApis.empty() || s_createdApis < s_poolSize;
+    });
+    if (!ready) {
+        return PooledApi{nullptr, 0, "", profile};
+    }
+    
+    const std::string language = requested.empty() ? s_language : requested;
+    auto takeIdle = [&](const std::string& wanted) {
+        auto match = std::find_if(s_idleApis.rbegin(), s_idleApis.rend(), [&](const PooledApi& pooled) {
+            return pooled.language == wanted && pooled.profile == profile;
+        });
+        if (match == s_idleApis.rend()) {
+            return PooledApi{nullptr, 0, "", profile};
+        }
+        PooledApi pooled = *match;
+        s_idleApis.erase(std::next(match).base());
+        return pooled;
+    };
+    PooledApi idle = takeIdle(language);
+    if (idle.api) {
+        return idle;
     }
     
-    // Store the API pointer and set initialization flag
-    m_tessApi = api;
-    m_initialized = true;
+    PooledApi evicted{nullptr, 0, "", profile};
+    if (s_createdApis >= s_poolSize) {
+        if (language != s_language) {
+            idle = takeIdle(s_language);
+            if (idle.api) {
+                return idle;
+            }
+        }
+        if (mode == Checkout::Existing) {
+            return PooledApi{nullptr, 0, "", profile};
+        }
+        
+        // Make room by dropping the least recently returned idle instance,
+        // sparing the accurate one that Auto escalates with if possible
+        auto victim = std::find_if(s_idleApis.begin(), s_idleApis.end(), [](const PooledApi& pooled) {
+            return s_profile != OcrEngine::Profile::Auto || pooled.profile != OcrEngine::Profile::Accurate;
+        });
+        if (victim == s_idleApis.end()) {
+            victim = s_idleApis.begin();
+        }
+        evicted = *victim;
+        s_idleApis.erase(victim);
+        --s_createdApis;
+    }
+    
+    // Reserve a slot, then load the language data without holding the lock
+    ++s_createdApis;
+    PooledApi pooled{nullptr, s_poolGeneration, language, profile};
+    std::string dataPath = profile == OcrEngine::Profile::Fast ? s_fastDataPath : s_accurateDataPath;
+    lock.unlock();
+    
+    if (evicted.api) {
+        DestroyApi(evicted.api);
+    }
+    pooled.api = CreateApi(language, dataPath, profile);
+    if (!pooled.api) {
+        lock.lock();
+        --s_createdApis;
+        s_poolAvailable.notify_one();
+    }
+    return pooled;
+}
+
+static void ReturnApi(PooledApi pooled) {
+    // Drop the page but keep the language data for the next image
+    pooled.api->Clear();
+    
+    std::unique_lock<std::mutex> lock(s_poolMutex);
+    MarkUsed();
+    if (pooled.generation != s_poolGeneration || s_createdApis > s_poolSize) {
+        // Reinitialized or shrunk while this instance was out
+        --s_createdApis;
+        lock.unlock();
+        DestroyApi(pooled.api);
+    } else {
+        s_idleApis.push_back(pooled);
+        lock.unlock();
+    }
+    s_poolAvailable.notify_one();
+}
+
+// Holds a pooled instance for the lifetime of one request
+class EngineLease {
+public:
+    EngineLease(std::chrono::milliseconds wait, const std::string& language, OcrEngine::Profile profile,
+                Checkout mode = Checkout::Replace)
+        : m_pooled(CheckoutApi(wait, language, profile, mode)) {}
+    ~EngineLease() {
+        if (m_pooled.api) {
+            ReturnApi(m_pooled);
+        }
+    }
+    
+    EngineLease(const EngineLease&) = delete;
+    EngineLease& operator=(const EngineLease&) = delete;
+    
+    TessBaseAPI* get() const { return m_pooled.api; }
+
+private:
+    PooledApi m_pooled;
+};
+
+static std::chrono::milliseconds CheckoutTimeout() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_checkoutTimeout;
+}
+
+static OcrPreprocess::Options PreprocessOptions() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_preprocessOptions;
+}
+
+static bool RegionDetection() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_regionDetection;
+}
+
+static OcrEngine::Profile CurrentProfile() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_profile;
+}
+
+static float EscalationThreshold() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_escalationThreshold;
+}
+
+// Split a language set like "eng+chi_sim+chi_tra" at the '+'
+static std::vector<std::string> SplitLanguages(const std::string& languages) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= languages.size()) {
+        size_t end = std::min(languages.find('+', start), languages.size());
+        if (end > start) {
+            parts.push_back(languages.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return parts;
+}
+
+static std::string ConfiguredLanguage() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_language;
+}
+
+// The configured language set with the model for the other script removed,
+// or empty if script detection is off or the set doesn't hold both scripts
+static std::string SingleScriptLanguage(ScriptDetect::Script script) {
+    std::string configured;
+    {
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        if (!s_scriptDetection) {
+            return "";
+        }
+        configured = s_language;
+    }
+    
+    std::vector<std::string> parts = SplitLanguages(configured);
+    bool hasSimplified = std::find(parts.begin(), parts.end(), "chi_sim") != parts.end();
+    bool hasTraditional = std::find(parts.begin(), parts.end(), "chi_tra") != parts.end();
+    if (!hasSimplified || !hasTraditional || script == ScriptDetect::Script::Unknown) {
+        return "";
+    }
+    
+    const char* drop = script == ScriptDetect::Script::Simplified ? "chi_tra" : "chi_sim";
+    std::string language;
+    for (const std::string& part : parts) {
+        if (part != drop) {
+            language += language.empty() ? part : "+" + part;
+        }
+    }
+    return language;
+}
+
+// Whether the configured language set holds both Chinese scripts, so a
+// sample is worth classifying
+static bool ScriptDetectionApplies() {
+    return !SingleScriptLanguage(ScriptDetect::Script::Simplified).empty();
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcrEngine::Initialize(const std::string& language) {
+    std::vector<PooledApi> stale;
+    {
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        
+        // Clean up any existing instances; ones in use are dropped on return
+        stale = TakeIdleApis();
+        ++s_poolGeneration;
+        s_language = language;
+    }
+    DestroyApis(stale);
+    
+    // Create the first instance now so a bad language fails here
+    {
+        EngineLease lease(std::chrono::milliseconds(0), "", FirstPassProfile(CurrentProfile()));
+        m_initialized = lease.get() != nullptr;
+    }
     // wxLogMessage("Tesseract OCR engine initialized successfully");
+    return m_initialized;
+}
+
+bool OcrEngine::EnsureInitialized(const std::string& language) {
+    if (m_initialized) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(s_initMutex);
+    if (m_initialized) {
+        return true;
+    }
+    return Initialize(language);
+}
+
+bool OcrEngine::Warmup(const std::string& language, const std::atomic<bool>* stop) {
+    if (!EnsureInitialized(language)) {
+        return false;
+    }
+    
+    // Fill the pool, and run each instance once on a small blank page. Plain
+    // bytes rather than a wxImage, since this runs on a worker thread.
+    const int BLANK_WIDTH = 64;
+    const int BLANK_HEIGHT = 32;
+    const std::vector<unsigned char> blank(BLANK_WIDTH * BLANK_HEIGHT * 3, 255);
+    
+    // In Auto, the last slot of a pool of two or more holds the accurate
+    // engine that weak lines are escalated to
+    const Profile configured = CurrentProfile();
+    const size_t poolSize = GetPoolSize();
+    std::vector<std::unique_ptr<EngineLease>> leases;
+    for (size_t i = 0; i < poolSize && !(stop && stop->load()); ++i) {
+        bool escalation = configured == Profile::Auto && poolSize > 1 && i == poolSize - 1;
+        Profile profile = escalation ? Profile::Accurate : FirstPassProfile(configured);
+        auto lease = std::make_unique<EngineLease>(std::chrono::milliseconds(0), "", profile);
+        if (!lease->get()) {
+            break;
+        }
+        lease->get()->SetImage(blank.data(), BLANK_WIDTH, BLANK_HEIGHT, 3, BLANK_WIDTH * 3);
+        lease->get()->Recognize(nullptr);
+        leases.push_back(std::move(lease));
+    }
     return true;
 }
 
 void OcrEngine::Cleanup() {
-    if (m_initialized) {
-        tesseract::TessBaseAPI* api = new tesseract::TessBaseAPI();
-        // This forces Tesseract to clean up its cached data
-        api->End();
-        delete api;
-        m_initialized = false;
+    SetIdleUnloadTimeout(std::chrono::seconds(0));
+    
+    std::vector<PooledApi> idle;
+    {
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        idle = TakeIdleApis();
+        ++s_poolGeneration;
+    }
+    DestroyApis(idle);
+    m_initialized = false;
+}
+
+void OcrEngine::SetPoolSize(size_t size) {
+    std::vector<PooledApi> surplus;
+    {
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        s_poolSize = std::max<size_t>(size, 1);
+        
+        // Shrink right away as far as idle instances allow; busy ones are
+        // dropped when they come back
+        while (s_createdApis > s_poolSize && !s_idleApis.empty()) {
+            surplus.push_back(s_idleApis.back());
+            s_idleApis.pop_back();
+            --s_createdApis;
+        }
+    }
+    DestroyApis(surplus);
+    s_poolAvailable.notify_all();
+}
+
+size_t OcrEngine::GetPoolSize() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_poolSize;
+}
+
+void OcrEngine::SetCheckoutTimeout(std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_checkoutTimeout = timeout;
+}
+
+void OcrEngine::SetPreprocessOptions(const OcrPreprocess::Options& options) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_preprocessOptions = options;
+}
+
+void OcrEngine::SetRegionDetection(bool enabled) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_regionDetection = enabled;
+}
+
+void OcrEngine::SetScriptDetection(bool enabled) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_scriptDetection = enabled;
+}
+
+void OcrEngine::SetProfile(Profile profile) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_profile = profile;
+}
+
+OcrEngine::Profile OcrEngine::GetProfile() {
+    return CurrentProfile();
+}
+
+void OcrEngine::SetModelPaths(const std::string& fastDataPath, const std::string& accurateDataPath) {
+    std::vector<PooledApi> stale;
+    {
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        s_fastDataPath = fastDataPath;
+        s_accurateDataPath = accurateDataPath;
+        
+        // Instances loaded from the old paths are dropped, busy ones on return
+        stale = TakeIdleApis();
+        ++s_poolGeneration;
     }
+    DestroyApis(stale);
+    s_poolAvailable.notify_all();
+}
+
+void OcrEngine::SetEscalationThreshold(float confidence) {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    s_escalationThreshold = confidence;
+}
+
+OcrTimings OcrEngine::GetLastTimings() {
+    std::lock_guard<std::mutex> lock(s_timingsMutex);
+    return s_lastTimings;
+}
+
+void OcrEngine::SetIdleUnloadTimeout(std::chrono::seconds timeout) {
+    std::thread finished;
+    {
+        std::lock_guard<std::mutex> lock(s_idleMutex);
+        s_idleTimeout = timeout;
+        if (timeout.count() > 0 && !s_idleThread.joinable()) {
+            s_idleStop = false;
+            s_idleThread = std::thread([]() {
+                std::unique_lock<std::mutex> lock(s_idleMutex);
+                while (!s_idleStop) {
+                    auto lastUsed = std::chrono::steady_clock::time_point(
+                        std::chrono::steady_clock::duration(s_lastUsed.load()));
+                    auto deadline = lastUsed + s_idleTimeout;
+                    
+                    if (std::chrono::steady_clock::now() >= deadline) {
+                        // Instances still in use are freed after their own idle period
+                        std::vector<PooledApi> idle;
+                        {
+                            std::lock_guard<std::mutex> poolLock(s_poolMutex);
+                            idle = TakeIdleApis();
+                        }
+                        if (!idle.empty()) {
+                            wxLogDebug("Unloading %zu idle OCR engine(s)", idle.size());
+                            DestroyApis(idle);
+                        }
+                        deadline = std::chrono::steady_clock::now() + s_idleTimeout;
+                    }
+                    
+                    s_idleChanged.wait_until(lock, deadline);
+                }
+            });
+        } else if (timeout.count() == 0 && s_idleThread.joinable()) {
+            s_idleStop = true;
+            finished = std::move(s_idleThread);
+        }
+    }
+    s_idleChanged.notify_all();
+    
+    if (finished.joinable()) {
+        finished.join();
+    }
+}
+
+// Tesseract polls this between words; returning true abandons the page
+static bool OcrCancelCallback(void* cancelThis, int /*words*/) {
+    const std::atomic<bool>* cancel = static_cast<const std::atomic<bool>*>(cancelThis);
+    return cancel && cancel->load();
 }
 
 wxString OcrEngine::ExtractTextFromBitmap(const wxBitmap& bitmap) {
-    if (!m_initialized) {
-        return "";
+    return ExtractTextFromImage(PixelBuffer::FromBitmap(bitmap));
+}
+
+// Per-strip numbers collected for OcrTimings
+struct StripStats {
+    double detectMs = 0;
+    double recognizeMs = 0;
+    double escalateMs = 0;
+    size_t regions = 0;
+    size_t escalatedLines = 0;
+    double textArea = 1.0;  // Fraction of the strip that was recognized
+};
+
+// Area of a strip, in strip coordinates, that holds text
+struct TextRegion {
+    int left;
+    int top;
+    int right;   // Exclusive
+    int bottom;  // Exclusive
+};
+
+// Past this fraction of the strip, recognizing regions one by one costs more
+// than recognizing the whole strip at once
+static const double MAX_REGION_AREA = 0.7;
+
+// Find the text lines in rows [top, bottom) with Tesseract's layout analysis,
+// run on a copy shrunk by `detectScale`. Lines are padded and merged where
+// they touch, so a paragraph becomes one region.
+static std::vector<TextRegion> DetectTextRegions(TessBaseAPI* api, const GrayImage& image,
+                                                 int top, int bottom, int detectScale) {
+    const int PADDING = 8;
+    const int stripHeight = bottom - top;
+    
+    GrayImage strip(image.width, stripHeight);
+    std::copy(image.Row(top), image.Row(bottom), strip.pixels.begin());
+    GrayImage small = detectScale > 1
+        ? OcrPreprocess::Resample(strip, std::max(1, image.width / detectScale), std::max(1, stripHeight / detectScale))
+        : std::move(strip);
+    
+    api->SetImage(small.pixels.data(), small.width, small.height, 1, small.width);
+    api->SetSourceResolution(300 / detectScale);
+    Boxa* boxes = api->GetComponentImages(tesseract::RIL_TEXTLINE, true, nullptr, nullptr);
+    
+    std::vector<TextRegion> regions;
+    if (boxes) {
+        for (int i = 0; i < boxaGetCount(boxes); ++i) {
+            l_int32 x, y, w, h;
+            if (boxaGetBoxGeometry(boxes, i, &x, &y, &w, &h) != 0) {
+                continue;
+            }
+            TextRegion region;
+            region.left = std::max(0, x * detectScale - PADDING);
+            region.top = std::max(0, y * detectScale - PADDING);
+            region.right = std::min(image.width, (x + w) * detectScale + PADDING);
+            region.bottom = std::min(stripHeight, (y + h) * detectScale + PADDING);
+            if (region.right > region.left && region.bottom > region.top) {
+                regions.push_back(region);
+            }
+        }
+        boxaDestroy(&boxes);
+    }
+    
+    // Merge overlapping regions until none overlap
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < regions.size(); ++j) {
+                TextRegion& a = regions[i];
+                const TextRegion& b = regions[j];
+                if (a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom) {
+                    a.left = std::min(a.left, b.left);
+                    a.top = std::min(a.top, b.top);
+                    a.right = std::max(a.right, b.right);
+                    a.bottom = std::max(a.bottom, b.bottom);
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
     }
     
-    // Create a new API instance for this extraction
-    tesseract::TessBaseAPI* api = new tesseract::TessBaseAPI();
+    // Reading order: top to bottom, then left to right
+    std::sort(regions.begin(), regions.end(), [](const TextRegion& a, const TextRegion& b) {
+        return a.top != b.top ? a.top < b.top : a.left < b.left;
+    });
+    return regions;
+}
+
+// One recognized text line
+struct RecognizedLine {
+    std::string text;        // Ends with a newline
+    float confidence;        // Mean word confidence, 0-100
+    int left, top, right, bottom;  // In strip coordinates
+    bool paragraphStart;
+};
+
+static void SetCommonVariables(TessBaseAPI* api) {
+    // Set a timeout limit (10 seconds)
+    api->SetVariable("time_limit_per_page_ms", "10000");
     
-    // Initialize API with existing language data
-    if (api->Init(NULL, "chi_sim+chi_tra") != 0) {
-        delete api;
-        return "Error initializing Tesseract";
+    // Improve reliability for mixed scripts
+    api->SetVariable("preserve_interword_spaces", "1");
+    api->SetVariable("tessedit_char_blacklist", "");  // Clear any blacklists
+}
+
+// Append the text lines of the last recognition, with their confidence and
+// position
+static void CollectLines(TessBaseAPI* api, std::vector<RecognizedLine>& lines) {
+    std::unique_ptr<tesseract::ResultIterator> it(api->GetIterator());
+    if (!it) {
+        return;
     }
+    do {
+        if (it->Empty(tesseract::RIL_TEXTLINE)) {
+            continue;
+        }
+        RecognizedLine line;
+        char* lineText = it->GetUTF8Text(tesseract::RIL_TEXTLINE);
+        line.text = lineText ? lineText : "";
+        delete[] lineText;
+        if (line.text.empty() || line.text.back() != '\n') {
+            line.text += '\n';
+        }
+        line.confidence = it->Confidence(tesseract::RIL_TEXTLINE);
+        it->BoundingBox(tesseract::RIL_TEXTLINE, &line.left, &line.top, &line.right, &line.bottom);
+        line.paragraphStart = it->IsAtBeginningOf(tesseract::RIL_PARA);
+        lines.push_back(std::move(line));
+    } while (it->Next(tesseract::RIL_TEXTLINE));
+}
+
+// Lines joined as Tesseract would: a blank line between paragraphs
+static std::string JoinLines(const std::vector<RecognizedLine>& lines) {
+    std::string text;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0 && lines[i].paragraphStart) {
+            text += '\n';
+        }
+        text += lines[i].text;
+    }
+    return text;
+}
+
+// Recognize rows [top, bottom) of a prepared image. With detectScale > 0 the
+// text lines are located first and only those areas are recognized. Returns
+// false if the request was cancelled or recognition failed.
+static bool RecognizeRows(TessBaseAPI* api, const GrayImage& image, int top, int bottom,
+                          int detectScale, OcrEngine::Profile profile, const std::atomic<bool>* cancel,
+                          std::vector<RecognizedLine>& lines, StripStats& stats) {
+    SetCommonVariables(api);
     
-    try {
-        // Set page segmentation mode to automatic
+    std::vector<TextRegion> regions;
+    bool useRegions = false;
+    if (detectScale > 0) {
+        auto detectStart = std::chrono::steady_clock::now();
         api->SetPageSegMode(tesseract::PSM_AUTO);
+        regions = DetectTextRegions(api, image, top, bottom, detectScale);
+        stats.detectMs = MillisecondsSince(detectStart);
         
-        // Set a timeout limit (10 seconds)
-        api->SetVariable("time_limit_per_page_ms", "10000");
+        double area = 0;
+        for (const TextRegion& region : regions) {
+            area += static_cast<double>(region.right - region.left) * (region.bottom - region.top);
+        }
+        double fraction = area / (static_cast<double>(image.width) * (bottom - top));
+        useRegions = fraction < MAX_REGION_AREA;
+        if (useRegions) {
+            stats.regions = regions.size();
+            stats.textArea = fraction;
+        }
+        if (regions.empty()) {
+            // Nothing that looks like text; skip recognition entirely
+            lines.clear();
+            return !(cancel && cancel->load());
+        }
+    }
+    
+    auto recognizeStart = std::chrono::steady_clock::now();
+    api->SetPageSegMode(SettingsFor(profile).pageSegMode);
+    
+    // Set image data: one byte per pixel, already at roughly 300 DPI
+    api->SetImage(image.Row(top), image.width, bottom - top, 1, image.width);
+    api->SetSourceResolution(300);
+    
+    // Recognize with a monitor so a superseded request can stop early
+    tesseract::ETEXT_DESC monitor;
+    monitor.cancel = OcrCancelCallback;
+    monitor.cancel_this = const_cast<std::atomic<bool>*>(cancel);
+    
+    if (!useRegions) {
+        regions.assign(1, TextRegion{0, 0, image.width, bottom - top});
+    }
+    lines.clear();
+    for (const TextRegion& region : regions) {
+        if (useRegions) {
+            api->SetRectangle(region.left, region.top, region.right - region.left, region.bottom - region.top);
+        }
+        if (api->Recognize(&monitor) != 0 || (cancel && cancel->load())) {
+            return false;
+        }
+        CollectLines(api, lines);
+    }
+    stats.recognizeMs = MillisecondsSince(recognizeStart);
+    return true;
+}
+
+// Read the lines below the confidence threshold again, one by one, with an
+// accurate-profile engine. A new reading replaces the old one only if it is
+// more confident. Returns false if the request was cancelled.
+static bool EscalateLines(TessBaseAPI* api, const GrayImage& image, int top, int bottom, float threshold,
+                          const std::atomic<bool>* cancel, std::vector<RecognizedLine>& lines,
+                          StripStats& stats) {
+    const int PADDING = 4;
+    auto escalateStart = std::chrono::steady_clock::now();
+    
+    SetCommonVariables(api);
+    api->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+    api->SetImage(image.Row(top), image.width, bottom - top, 1, image.width);
+    api->SetSourceResolution(300);
+    
+    tesseract::ETEXT_DESC monitor;
+    monitor.cancel = OcrCancelCallback;
+    monitor.cancel_this = const_cast<std::atomic<bool>*>(cancel);
+    
+    for (RecognizedLine& line : lines) {
+        if (line.confidence >= threshold) {
+            continue;
+        }
+        int left = std::max(0, line.left - PADDING);
+        int lineTop = std::max(0, line.top - PADDING);
+        int right = std::min(image.width, line.right + PADDING);
+        int lineBottom = std::min(bottom - top, line.bottom + PADDING);
+        if (right <= left || lineBottom <= lineTop) {
+            continue;
+        }
         
-        // Improve reliability for mixed scripts
-        api->SetVariable("preserve_interword_spaces", "1");
-        api->SetVariable("tessedit_char_blacklist", "");  // Clear any blacklists
+        api->SetRectangle(left, lineTop, right - left, lineBottom - lineTop);
+        if (api->Recognize(&monitor) != 0 || (cancel && cancel->load())) {
+            return false;
+        }
+        ++stats.escalatedLines;
         
-        // Convert wxBitmap to format Tesseract can use
-        wxImage image = bitmap.ConvertToImage();
+        char* outText = api->GetUTF8Text();
+        std::string text = outText ? outText : "";
+        delete[] outText;
+        float confidence = static_cast<float>(api->MeanTextConf());
+        if (text.find_first_not_of(" \t\r\n") != std::string::npos && confidence > line.confidence) {
+            while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+                text.pop_back();
+            }
+            line.text = text + '\n';
+            line.confidence = confidence;
+        }
+    }
+    stats.escalateMs = MillisecondsSince(escalateStart);
+    return true;
+}
+
+// Split text into lines without trailing blank lines
+static std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    while (!lines.empty() && lines.back().find_first_not_of(" \t\r") == std::string::npos) {
+        lines.pop_back();
+    }
+    return lines;
+}
+
+// Join strip texts top to bottom. Where a strip overlaps the one above, the
+// lines read twice are dropped from the lower strip.
+static std::string MergeStrips(const std::vector<OcrPreprocess::Strip>& strips,
+                               const std::vector<std::string>& texts) {
+    const size_t MAX_OVERLAP_LINES = 3;
+    std::vector<std::string> merged;
+    size_t previousEnd = 0;  // Lines belonging to the strip above start at previousStart
+    size_t previousStart = 0;
+    
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::vector<std::string> lines = SplitLines(texts[i]);
+        size_t skip = 0;
+        if (strips[i].overlapsPrevious) {
+            size_t previousCount = previousEnd - previousStart;
+            size_t limit = std::min({MAX_OVERLAP_LINES, previousCount, lines.size()});
+            for (size_t k = limit; k > 0; --k) {
+                if (std::equal(lines.begin(), lines.begin() + k, merged.begin() + (previousEnd - k))) {
+                    skip = k;
+                    break;
+                }
+            }
+        }
+        previousStart = merged.size();
+        merged.insert(merged.end(), lines.begin() + skip, lines.end());
+        previousEnd = merged.size();
+    }
+    
+    std::string result;
+    for (const std::string& line : merged) {
+        result += line;
+        result += '\n';
+    }
+    return result;
+}
+
+enum class StripResult { Done, Cancelled, NoEngine };
+
+// Recognize strips [first, last) with the given language set (the
+// configured one if empty). Each strip borrows its own engine, so up to
+// GetPoolSize() run at once and the rest wait for a free one. In the Auto
+// profile a strip's weak lines are then re-read on an accurate engine, but
+// only one that is loaded and idle (or fits in the pool), so escalation
+// never evicts a fast engine to load the accurate models. The fast one is
+// returned first, so a pool of one can't deadlock.
+static StripResult RecognizeStrips(const GrayImage& prepared, const std::vector<OcrPreprocess::Strip>& strips,
+                                   size_t first, size_t last, const std::string& language,
+                                   int detectScale, const std::atomic<bool>* cancel,
+                                   std::vector<std::string>& texts, std::vector<StripStats>& stats) {
+    const std::chrono::milliseconds checkoutTimeout = CheckoutTimeout();
+    const OcrEngine::Profile profile = CurrentProfile();
+    const OcrEngine::Profile firstPass = FirstPassProfile(profile);
+    const float threshold = EscalationThreshold();
+    auto recognize = [&](size_t i) {
+        std::vector<RecognizedLine> lines;
+        {
+            EngineLease lease(checkoutTimeout, language, firstPass);
+            if (!lease.get()) {
+                return StripResult::NoEngine;
+            }
+            if (!RecognizeRows(lease.get(), prepared, strips[i].top, strips[i].bottom, detectScale,
+                               firstPass, cancel, lines, stats[i])) {
+                return StripResult::Cancelled;
+            }
+        }
         
-        // Resize very large images to prevent crashes
-        const int MAX_DIMENSION = 2000; // Maximum dimension in pixels
-        bool resized = false;
+        bool weak = std::any_of(lines.begin(), lines.end(), [&](const RecognizedLine& line) {
+            return line.confidence < threshold;
+        });
+        if (profile == OcrEngine::Profile::Auto && weak) {
+            EngineLease lease(std::chrono::milliseconds(0), language, OcrEngine::Profile::Accurate,
+                              Checkout::Existing);
+            if (!lease.get()) {
+                wxLogDebug("No accurate OCR engine idle; keeping the fast reading");
+            } else if (!EscalateLines(lease.get(), prepared, strips[i].top, strips[i].bottom, threshold,
+                                      cancel, lines, stats[i])) {
+                return StripResult::Cancelled;
+            }
+        }
+        texts[i] = JoinLines(lines);
+        return StripResult::Done;
+    };
+    
+    if (last - first == 1) {
+        return recognize(first);
+    }
+    
+    std::vector<std::future<StripResult>> pending;
+    for (size_t i = first; i < last; ++i) {
+        pending.push_back(std::async(std::launch::async, recognize, i));
+    }
+    
+    bool cancelled = false;
+    bool noEngine = false;
+    for (auto& strip : pending) {
+        StripResult result = strip.get();
+        cancelled |= result == StripResult::Cancelled;
+        noEngine |= result == StripResult::NoEngine;
+    }
+    if (cancelled) {
+        return StripResult::Cancelled;
+    }
+    return noEngine ? StripResult::NoEngine : StripResult::Done;
+}
+
+// Recognize packed RGB pixels; both ExtractTextFromImage overloads end here
+static wxString RecognizePixels(const unsigned char* rgb, int width, int height, size_t stride,
+                                const std::atomic<bool>* cancel) {
+    try {
+        auto start = std::chrono::steady_clock::now();
+        
+        // Convert to gray, scale the text to a size Tesseract reads well
+        // (within the size limits, which prevent crashes) and binarize
+        OcrPreprocess::Options options = PreprocessOptions();
+        OcrPreprocess::Report report;
+        GrayImage prepared = OcrPreprocess::Prepare(rgb, width, height, stride, options, &report);
+        bool resized = report.limitedByMaxDimension;
         
-        if (image.GetWidth() > MAX_DIMENSION || image.GetHeight() > MAX_DIMENSION) {
-            // Calculate new dimensions while maintaining aspect ratio
-            double scale = std::min(
-                static_cast<double>(MAX_DIMENSION) / image.GetWidth(),
-                static_cast<double>(MAX_DIMENSION) / image.GetHeight()
-            );
-            
-            int newWidth = static_cast<int>(image.GetWidth() * scale);
-            int newHeight = static_cast<int>(image.GetHeight() * scale);
-            
-            image.Rescale(newWidth, newHeight, wxIMAGE_QUALITY_HIGH);
-            resized = true;
+        // With both Chinese scripts configured, a short first strip is read
+        // with both models as a sample. Its text decides the script, and the
+        // rest of the image is read with that model alone.
+        int sampleHeight = 0;
+        if (ScriptDetectionApplies()) {
+            sampleHeight = SCRIPT_SAMPLE_LINES * options.targetTextHeight * 3 / 2;
         }
         
-        // Get image data
-        unsigned char* imageData = image.GetData();
-        int width = image.GetWidth();
-        int height = image.GetHeight();
-        int bytesPerPixel = 3; // RGB format
+        // Large images are recognized as strips in parallel
+        std::vector<OcrPreprocess::Strip> strips;
+        if (options.tiled || sampleHeight > 0) {
+            int stripHeight = options.tiled ? options.stripHeight : prepared.height;
+            strips = OcrPreprocess::PlanStrips(prepared, stripHeight, options.stripOverlap, sampleHeight);
+        } else {
+            strips.push_back(OcrPreprocess::Strip{0, prepared.height, false});
+        }
+        wxLogDebug("OCR input %dx%d in %zu strip(s), text height %d, scale %.2f, skew %.2f",
+                   prepared.width, prepared.height, strips.size(), report.textHeight,
+                   report.scale, report.skewDegrees);
+        double preprocessMs = MillisecondsSince(start);
         
-        // Set image data
-        api->SetImage(imageData, width, height, bytesPerPixel, width * bytesPerPixel);
+        // Detect text on a half-size copy once the text height is known to
+        // be normalized; otherwise small text could vanish, so detect at
+        // full size
+        int detectScale = 0;
+        if (RegionDetection()) {
+            detectScale = (options.normalizeScale && report.textHeight > 0) ? 2 : 1;
+        }
         
-        // Extract text with safer method to prevent crashes
-        char* outText = nullptr;
-        try {
-            outText = api->GetUTF8Text();
-            wxString result = wxString::FromUTF8(outText);
-            delete[] outText;
-            
-            // Clean up
-            api->Clear();
-            api->End();
-            delete api;
-            
-            if (resized) {
-                result = "Note: Image was resized for processing.\n\n" + result;
-            }
-            
-            return result;
+        std::vector<std::string> texts(strips.size());
+        std::vector<StripStats> stats(strips.size());
+        StripResult outcome = StripResult::Done;
+        size_t next = 0;
+        std::string language;  // Empty for the configured set
+        ScriptDetect::Result script;
+        if (sampleHeight > 0 && strips.size() > 1) {
+            outcome = RecognizeStrips(prepared, strips, 0, 1, "", detectScale, cancel, texts, stats);
+            script = ScriptDetect::Classify(texts[0]);
+            language = SingleScriptLanguage(script.script);
+            next = 1;
         }
-        catch (...) {
-            // Handle errors during text extraction
-            if (outText) {
-                delete[] outText;
-            }
-            throw; // Re-throw to be caught by outer catch block
+        if (outcome == StripResult::Done) {
+            outcome = RecognizeStrips(prepared, strips, next, strips.size(), language, detectScale,
+                                      cancel, texts, stats);
+        }
+        if (outcome == StripResult::Cancelled || (cancel && cancel->load())) {
+            return "";
+        }
+        if (outcome == StripResult::NoEngine) {
+            return "OCR Error: no OCR engine available";
         }
+        
+        wxString result = wxString::FromUTF8(MergeStrips(strips, texts));
+        
+        OcrTimings timings;
+        timings.preprocessMs = preprocessMs;
+        timings.strips = strips.size();
+        double textRows = 0;
+        double stripRows = 0;
+        for (size_t i = 0; i < strips.size(); ++i) {
+            timings.detectMs += stats[i].detectMs;
+            timings.recognizeMs += stats[i].recognizeMs;
+            timings.escalateMs += stats[i].escalateMs;
+            timings.regions += stats[i].regions;
+            timings.escalatedLines += stats[i].escalatedLines;
+            textRows += stats[i].textArea * (strips[i].bottom - strips[i].top);
+            stripRows += strips[i].bottom - strips[i].top;
+        }
+        timings.textArea = stripRows > 0 ? textRows / stripRows : 1.0;
+        timings.totalMs = MillisecondsSince(start);
+        timings.language = language.empty() ? ConfiguredLanguage() : language;
+        {
+            std::lock_guard<std::mutex> lock(s_timingsMutex);
+            s_lastTimings = timings;
+        }
+        wxLogDebug("OCR took %.0f ms: preprocess %.0f, detect %.0f, recognize %.0f, "
+                   "escalate %.0f (%zu line(s)); %zu region(s) covering %.0f%% of the image; "
+                   "%s (script %s, %zu/%zu)",
+                   timings.totalMs, timings.preprocessMs, timings.detectMs, timings.recognizeMs,
+                   timings.escalateMs, timings.escalatedLines,
+                   timings.regions, timings.textArea * 100, timings.language.c_str(),
+                   ScriptDetect::ToString(script.script), script.simplified, script.traditional);
+        if (resized) {
+            result = "Note: Image was resized for processing.\n\n" + result;
+        }
+        return result;
     }
     catch (const std::exception& e) {
         // Handle any exceptions
-        try {
-            api->Clear();
-            api->End();
-            delete api;
-        } catch (...) {
-            // Ignore any errors during cleanup
-        }
         return wxString::Format("OCR Error: %s", e.what());
     }
     catch (...) {
         // Handle any other unexpected exceptions
-        try {
-            api->Clear();
-            api->End();
-            delete api;
-        } catch (...) {
-            // Ignore any errors during cleanup
-        }
         return "Unknown OCR error occurred";
     }
 }
 
+wxString OcrEngine::ExtractTextFromImage(const wxImage& image, const std::atomic<bool>* cancel) {
+    if (!m_initialized || !image.IsOk()) {
+        return "";
+    }
+    return RecognizePixels(image.GetData(), image.GetWidth(), image.GetHeight(),
+                           static_cast<size_t>(image.GetWidth()) * 3, cancel);
+}
+
+wxString OcrEngine::ExtractTextFromImage(const PixelBuffer& pixels, const std::atomic<bool>* cancel) {
+    if (!m_initialized || !pixels.IsOk()) {
+        return "";
+    }
+    return RecognizePixels(pixels.GetData(), pixels.GetWidth(), pixels.GetHeight(), pixels.GetStride(), cancel);
+}
+
+std::future<wxString> OcrEngine::ExtractTextAsync(const wxImage& image, const std::atomic<bool>* cancel) {
+    // wxImage reference counting isn't thread safe, so the worker gets its
+    // own unshared copy of the pixels
+    return ExtractTextAsync(PixelBuffer(image.Copy()), cancel);
+}
+
+std::future<wxString> OcrEngine::ExtractTextAsync(const PixelBuffer& pixels, const std::atomic<bool>* cancel) {
+    // The buffer is shared with the worker, not copied
+    return std::async(std::launch::async, [pixels, cancel]() {
+        return ExtractTextFromImage(pixels, cancel);
+    });
+}
+
 wxString OcrEngine::ExtractTextFromFile(const wxString& filePath) {
     if (!IsInitialized()) {
         wxLogError("OCR engine not initialized");
         return wxEmptyString;
     }
     
-    tesseract::TessBaseAPI* api = static_cast<tesseract::TessBaseAPI*>(m_tessApi);
+    EngineLease lease(CheckoutTimeout(), "", FirstPassProfile(CurrentProfile()));
+    TessBaseAPI* api = lease.get();
+    if (!api) {
+        wxLogError("No OCR engine available for %s", filePath);
+        return wxEmptyString;
+    }
     
     // Load the image using Leptonica
     PIX* pix = pixRead(filePath.mb_str());
@@ -162,19 +1078,26 @@ wxString OcrEngine::ExtractTextFromFile(const wxString& filePath) {
     }
     
     // Set the image for OCR
+    api->SetPageSegMode(tesseract::PSM_AUTO);
     api->SetImage(pix);
     
     // Get the recognized text
     char* text = api->GetUTF8Text();
-    wxString result(text);
+    wxString result = wxString::FromUTF8(text);
     
     // Clean up
     delete[] text;
+    api->Clear();
     pixDestroy(&pix);
     
     return result;
 }
 
 bool OcrEngine::IsInitialized() {
-    return m_initialized && m_tessApi != nullptr;
-} 
\ No newline at end of file
+    return m_initialized;
+}
+
+bool OcrEngine::IsLoaded() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_createdApis > 0;
+}
@@ -0,0 +1,357 @@
+#include "../include/ocr_cache.h"
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/stdpaths.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+// File header: magic and format version
+static const char CACHE_MAGIC[4] = {'H', 'S', 'O', 'C'};
+static const uint32_t CACHE_VERSION = 2;
+static const uint64_t HEADER_SIZE = sizeof(CACHE_MAGIC) + sizeof(CACHE_VERSION);
+
+// Record: text length, checksum, fingerprint, text
+static const size_t FINGERPRINT_SIZE = sizeof(uint64_t) * 6 + sizeof(int32_t) * 2;
+static const uint64_t RECORD_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + FINGERPRINT_SIZE;
+
+// Don't bother rewriting logs smaller than this
+static const uint64_t MIN_REWRITE_SIZE = 1024 * 1024;
+
+// Bookkeeping per entry on top of its text, for the memory budget
+static const size_t ENTRY_OVERHEAD = 128;
+
+static void EncodeFingerprint(const OcrCache::Fingerprint& fingerprint, char* out) {
+    int32_t width = fingerprint.perceptual.width;
+    int32_t height = fingerprint.perceptual.height;
+    std::memcpy(out, &fingerprint.exact, sizeof(uint64_t));
+    std::memcpy(out + 8, fingerprint.perceptual.bits, sizeof(uint64_t) * 4);
+    std::memcpy(out + 40, &fingerprint.perceptual.content, sizeof(uint64_t));
+    std::memcpy(out + 48, &width, sizeof(width));
+    std::memcpy(out + 52, &height, sizeof(height));
+}
+
+static OcrCache::Fingerprint DecodeFingerprint(const char* in) {
+    OcrCache::Fingerprint fingerprint;
+    int32_t width = 0;
+    int32_t height = 0;
+    std::memcpy(&fingerprint.exact, in, sizeof(uint64_t));
+    std::memcpy(fingerprint.perceptual.bits, in + 8, sizeof(uint64_t) * 4);
+    std::memcpy(&fingerprint.perceptual.content, in + 40, sizeof(uint64_t));
+    std::memcpy(&width, in + 48, sizeof(width));
+    std::memcpy(&height, in + 52, sizeof(height));
+    fingerprint.perceptual.width = width;
+    fingerprint.perceptual.height = height;
+    return fingerprint;
+}
+
+static uint64_t RecordChecksum(const char* fingerprint, const std::string& text) {
+    return HashBytes(text.data(), text.size(), HashBytes(fingerprint, FINGERPRINT_SIZE));
+}
+
+static void WriteHeader(std::ostream& out) {
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+}
+
+static void WriteRecord(std::ostream& out, const OcrCache::Fingerprint& fingerprint, const std::string& text) {
+    char encoded[FINGERPRINT_SIZE];
+    EncodeFingerprint(fingerprint, encoded);
+    uint32_t textLength = static_cast<uint32_t>(text.size());
+    uint64_t checksum = RecordChecksum(encoded, text);
+    out.write(reinterpret_cast<const char*>(&textLength), sizeof(textLength));
+    out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    out.write(encoded, FINGERPRINT_SIZE);
+    out.write(text.data(), text.size());
+}
+
+OcrCache::OcrCache(const wxString& path, size_t maxMemoryBytes, int maxDistance)
+    : m_path(path.utf8_str()),
+      m_maxMemoryBytes(maxMemoryBytes),
+      m_maxDistance(maxDistance),
+      m_fileSize(0),
+      m_lruBytes(0)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_path.empty()) {
+        Load();
+    }
+}
+
+OcrCache::~OcrCache()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+wxString OcrCache::DefaultPath()
+{
+    wxFileName path(wxStandardPaths::Get().GetUserDataDir(), "ocr_cache.log");
+    path.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    return path.GetFullPath();
+}
+
+OcrCache::Fingerprint OcrCache::ComputeFingerprint(const PixelBuffer& pixels)
+{
+    Fingerprint fingerprint;
+    fingerprint.exact = HashImagePixels(pixels);
+    fingerprint.perceptual = ComputePerceptualHash(pixels);
+    return fingerprint;
+}
+
+size_t OcrCache::EntryBytes(const Entry& entry)
+{
+    return entry.text.size() + ENTRY_OVERHEAD;
+}
+
+bool OcrCache::IsNearDuplicate(const Fingerprint& a, const Fingerprint& b) const
+{
+    if (!a.perceptual.IsValid() || !b.perceptual.IsValid()) {
+        return false;
+    }
+
+    // Same content inside a different border
+    if (a.perceptual.content == b.perceptual.content &&
+        a.perceptual.width == b.perceptual.width && a.perceptual.height == b.perceptual.height) {
+        return true;
+    }
+    if (m_maxDistance < 0) {
+        return false;
+    }
+
+    // Opt-in fuzzy match. The content must be the same size give or take a
+    // pixel or two, so a zoomed or differently cropped picture never matches
+    auto close = [](int x, int y) {
+        return std::abs(x - y) <= std::max(2, std::max(x, y) / 100);
+    };
+    return close(a.perceptual.width, b.perceptual.width) &&
+           close(a.perceptual.height, b.perceptual.height) &&
+           HammingDistance(a.perceptual, b.perceptual) <= m_maxDistance;
+}
+
+void OcrCache::Load()
+{
+    // Create the file with a header if it doesn't exist yet
+    std::ifstream probe(m_path, std::ios::binary);
+    bool exists = probe.good();
+    probe.close();
+    if (!exists) {
+        std::ofstream create(m_path, std::ios::binary);
+        WriteHeader(create);
+    }
+
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open()) {
+        wxLogWarning("Could not open OCR cache: %s", wxString::FromUTF8(m_path));
+        return;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    m_file.read(magic, sizeof(magic));
+    m_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!m_file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION) {
+        // Unknown format: start over rather than guess
+        m_file.close();
+        std::ofstream reset(m_path, std::ios::binary | std::ios::trunc);
+        WriteHeader(reset);
+        reset.close();
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+        m_fileSize = HEADER_SIZE;
+        return;
+    }
+
+    m_file.seekg(0, std::ios::end);
+    uint64_t totalSize = static_cast<uint64_t>(m_file.tellg());
+    m_file.seekg(HEADER_SIZE);
+
+    // Replay records oldest first, so the newest end up most recently used
+    uint64_t offset = HEADER_SIZE;
+    char encoded[FINGERPRINT_SIZE];
+    std::string text;
+    while (true) {
+        uint32_t textLength = 0;
+        uint64_t checksum = 0;
+        m_file.read(reinterpret_cast<char*>(&textLength), sizeof(textLength));
+        m_file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+        m_file.read(encoded, FINGERPRINT_SIZE);
+        if (!m_file || offset + RECORD_HEADER_SIZE + textLength > totalSize) {
+            break;
+        }
+
+        text.resize(textLength);
+        m_file.read(&text[0], textLength);
+        if (!m_file || RecordChecksum(encoded, text) != checksum) {
+            wxLogDebug("OCR cache: dropping torn record at offset %llu",
+                       static_cast<unsigned long long>(offset));
+            break;
+        }
+
+        Remember(Entry{DecodeFingerprint(encoded), text});
+        offset += RECORD_HEADER_SIZE + textLength;
+    }
+    m_fileSize = offset;
+    m_file.clear();
+
+    // Cut off a torn tail so new records follow the last good one
+    if (totalSize > m_fileSize) {
+        m_file.close();
+        std::error_code error;
+        std::filesystem::resize_file(m_path, m_fileSize, error);
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    wxLogDebug("OCR cache loaded: %zu entries, %llu bytes",
+               m_lru.size(), static_cast<unsigned long long>(m_fileSize));
+
+    // Rewrite when most of the log is entries that no longer fit in memory
+    uint64_t liveBytes = HEADER_SIZE;
+    for (const Entry& entry : m_lru) {
+        liveBytes += RECORD_HEADER_SIZE + entry.text.size();
+    }
+    if (m_fileSize > MIN_REWRITE_SIZE && m_fileSize > 2 * liveBytes) {
+        Rewrite();
+    }
+}
+
+void OcrCache::Rewrite()
+{
+    std::string tempPath = m_path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return;
+    }
+    WriteHeader(out);
+
+    uint64_t size = HEADER_SIZE;
+    for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it) {
+        WriteRecord(out, it->fingerprint, it->text);
+        size += RECORD_HEADER_SIZE + it->text.size();
+    }
+    out.close();
+    if (!out) {
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    m_file.close();
+    if (std::rename(tempPath.c_str(), m_path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+        return;
+    }
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+
+    wxLogDebug("OCR cache rewritten from %llu to %llu bytes",
+               static_cast<unsigned long long>(m_fileSize), static_cast<unsigned long long>(size));
+    m_fileSize = size;
+}
+
+bool OcrCache::Append(const Entry& entry)
+{
+    m_file.seekp(m_fileSize);
+    WriteRecord(m_file, entry.fingerprint, entry.text);
+    m_file.flush();
+    if (!m_file) {
+        m_file.clear();
+        return false;
+    }
+    m_fileSize += RECORD_HEADER_SIZE + entry.text.size();
+    return true;
+}
+
+void OcrCache::Remember(Entry entry)
+{
+    auto existing = m_index.find(entry.fingerprint.exact);
+    if (existing != m_index.end()) {
+        m_lruBytes -= EntryBytes(*existing->second);
+        m_lru.erase(existing->second);
+        m_index.erase(existing);
+    }
+
+    m_lruBytes += EntryBytes(entry);
+    m_lru.push_front(std::move(entry));
+    m_index[m_lru.front().fingerprint.exact] = m_lru.begin();
+
+    // Evict least recently used, but always keep the newest entry
+    while (m_lruBytes > m_maxMemoryBytes && m_lru.size() > 1) {
+        m_lruBytes -= EntryBytes(m_lru.back());
+        m_index.erase(m_lru.back().fingerprint.exact);
+        m_lru.pop_back();
+    }
+}
+
+bool OcrCache::Lookup(const Fingerprint& fingerprint, wxString& text)
+{
+    if (fingerprint.exact == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto exact = m_index.find(fingerprint.exact);
+    if (exact != m_index.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, exact->second);
+        text = wxString::FromUTF8(exact->second->text.data(), exact->second->text.size());
+        ++m_stats.exactHits;
+        return true;
+    }
+
+    // Closest near-duplicate, if any is close enough
+    auto best = m_lru.end();
+    int bestDistance = 0;
+    for (auto it = m_lru.begin(); it != m_lru.end(); ++it) {
+        if (IsNearDuplicate(fingerprint, it->fingerprint)) {
+            int distance = HammingDistance(fingerprint.perceptual, it->fingerprint.perceptual);
+            if (best == m_lru.end() || distance < bestDistance) {
+                best = it;
+                bestDistance = distance;
+            }
+        }
+    }
+    if (best == m_lru.end()) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, best);
+    text = wxString::FromUTF8(best->text.data(), best->text.size());
+    ++m_stats.nearHits;
+    wxLogDebug("OCR cache: near-duplicate hit at distance %d", bestDistance);
+    return true;
+}
+
+void OcrCache::Store(const Fingerprint& fingerprint, const wxString& text)
+{
+    if (fingerprint.exact == 0) {
+        return;
+    }
+    std::string utf8(text.utf8_str());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Only write when something changed
+    auto existing = m_index.find(fingerprint.exact);
+    bool unchanged = existing != m_index.end() && existing->second->text == utf8;
+    Entry entry{fingerprint, std::move(utf8)};
+    if (!unchanged && m_file.is_open() && !Append(entry)) {
+        wxLogDebug("OCR cache: failed to write entry");
+    }
+    Remember(std::move(entry));
+}
+
+size_t OcrCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lru.size();
+}
+
+OcrCache::Stats OcrCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
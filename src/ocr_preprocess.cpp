@@ -0,0 +1,585 @@
+#include "../include/ocr_preprocess.h"
+#include <algorithm>
+#include <cmath>
+
+namespace OcrPreprocess {
+
+namespace {
+
+    const double PI = 3.14159265358979323846;
+
+    // Rows with less ink than this fraction of the width don't count as text
+    const double MIN_ROW_INK = 0.002;
+    // Shorter runs of inked rows are rules, underlines or noise
+    const int MIN_LINE_HEIGHT = 4;
+    // Points used for skew estimation; larger images are subsampled
+    const size_t MAX_SKEW_POINTS = 200000;
+
+    // Text evidence grid: about this many cells along the longer side, but
+    // no smaller than MIN_EVIDENCE_CELL pixels, and about MAX_EVIDENCE_SAMPLES
+    // pixels sampled in whole rows
+    const int EVIDENCE_GRID = 256;
+    const int MIN_EVIDENCE_CELL = 4;
+    const size_t MAX_EVIDENCE_SAMPLES = 120000;
+    // Stroke cells span at least this much luminance, with a variance of at
+    // least STROKE_SPREAD times the squared span (two tones rather than a
+    // smooth ramp or noise)
+    const int STROKE_CONTRAST = 96;
+    const double STROKE_SPREAD = 0.1;
+    // Quiet cells vary by less than this (a standard deviation of 10)
+    const double QUIET_VARIANCE = 100.0;
+
+    // Source pixels and weights contributing to each output pixel of a 1-D resample
+    struct Taps {
+        std::vector<size_t> start;  // Output i uses entries [start[i], start[i + 1])
+        std::vector<int> index;
+        std::vector<float> weight;
+    };
+
+    Taps BuildTaps(int srcSize, int dstSize) {
+        Taps taps;
+        taps.start.reserve(dstSize + 1);
+        double scale = static_cast<double>(srcSize) / dstSize;
+
+        for (int i = 0; i < dstSize; ++i) {
+            taps.start.push_back(taps.index.size());
+            if (scale >= 1.0) {
+                // Shrinking: average the source pixels the output pixel covers
+                double a = i * scale;
+                double b = std::min((i + 1) * scale, static_cast<double>(srcSize));
+                for (int j = static_cast<int>(a); j < b; ++j) {
+                    double overlap = std::min(b, j + 1.0) - std::max(a, static_cast<double>(j));
+                    if (overlap > 0) {
+                        taps.index.push_back(j);
+                        taps.weight.push_back(static_cast<float>(overlap / scale));
+                    }
+                }
+            } else {
+                // Enlarging: interpolate between the two nearest source pixels
+                double pos = (i + 0.5) * scale - 0.5;
+                int j = static_cast<int>(std::floor(pos));
+                float f = static_cast<float>(pos - j);
+                taps.index.push_back(std::clamp(j, 0, srcSize - 1));
+                taps.weight.push_back(1.0f - f);
+                taps.index.push_back(std::clamp(j + 1, 0, srcSize - 1));
+                taps.weight.push_back(f);
+            }
+        }
+        taps.start.push_back(taps.index.size());
+        return taps;
+    }
+
+    // Count of ink pixels in each row
+    std::vector<int> RowInk(const GrayImage& binary) {
+        std::vector<int> ink(binary.height, 0);
+        for (int y = 0; y < binary.height; ++y) {
+            const uint8_t* row = binary.Row(y);
+            int count = 0;
+            for (int x = 0; x < binary.width; ++x) {
+                count += row[x] == 0;
+            }
+            ink[y] = count;
+        }
+        return ink;
+    }
+
+}
+
+TextEvidence MeasureTextEvidence(const uint8_t* rgb, int width, int height, size_t stride) {
+    TextEvidence evidence;
+    if (width <= 0 || height <= 0) {
+        return evidence;
+    }
+
+    const int cell = std::max(MIN_EVIDENCE_CELL, (std::max(width, height) + EVIDENCE_GRID - 1) / EVIDENCE_GRID);
+    const int gridWidth = (width + cell - 1) / cell;
+    const int gridHeight = (height + cell - 1) / cell;
+    // Skip rows to stay near the sample budget, but sample every row of
+    // cells at least twice, or a single line of text could fall between the
+    // sampled rows on large images. What the budget still needs beyond that
+    // comes from skipping columns within each cell.
+    const size_t pixels = static_cast<size_t>(width) * height;
+    const int maxStep = std::max(1, cell / 2);
+    const int rowStep = std::min(static_cast<int>((pixels + MAX_EVIDENCE_SAMPLES - 1) / MAX_EVIDENCE_SAMPLES), maxStep);
+    const size_t rowSamples = static_cast<size_t>((height + rowStep - 1) / rowStep) * width;
+    const int columnStep = std::min(static_cast<int>((rowSamples + MAX_EVIDENCE_SAMPLES - 1) / MAX_EVIDENCE_SAMPLES), maxStep);
+
+    struct CellStats {
+        uint32_t count = 0;
+        uint32_t sum = 0;
+        uint64_t sumSquares = 0;
+        uint8_t low = 255;
+        uint8_t high = 0;
+    };
+    std::vector<CellStats> stats(static_cast<size_t>(gridWidth) * gridHeight);
+
+    for (int y = 0; y < height; y += rowStep) {
+        const uint8_t* src = rgb + y * stride;
+        CellStats* rowStats = stats.data() + static_cast<size_t>(y / cell) * gridWidth;
+        for (int cx = 0; cx < gridWidth; ++cx) {
+            const int x0 = cx * cell;
+            const int x1 = std::min(width, x0 + cell);
+            uint32_t sum = 0;
+            uint32_t sumSquares = 0;
+            uint8_t low = rowStats[cx].low;
+            uint8_t high = rowStats[cx].high;
+            for (int x = x0; x < x1; x += columnStep) {
+                const uint8_t* p = src + 3 * x;
+                uint32_t l = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+                low = std::min(low, static_cast<uint8_t>(l));
+                high = std::max(high, static_cast<uint8_t>(l));
+                sum += l;
+                sumSquares += l * l;
+            }
+            rowStats[cx].count += (x1 - x0 + columnStep - 1) / columnStep;
+            rowStats[cx].sum += sum;
+            rowStats[cx].sumSquares += sumSquares;
+            rowStats[cx].low = low;
+            rowStats[cx].high = high;
+        }
+    }
+
+    enum : uint8_t { Other, Stroke, Quiet };
+    std::vector<uint8_t> kind(stats.size(), Other);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const CellStats& s = stats[i];
+        if (s.count == 0) {
+            continue;
+        }
+        const double mean = static_cast<double>(s.sum) / s.count;
+        const double variance = static_cast<double>(s.sumSquares) / s.count - mean * mean;
+        const int span = s.high - s.low;
+        if (span >= STROKE_CONTRAST && variance >= STROKE_SPREAD * span * span) {
+            kind[i] = Stroke;
+        } else if (variance < QUIET_VARIANCE) {
+            kind[i] = Quiet;
+        }
+    }
+
+    evidence.cells = stats.size();
+    for (int cy = 0; cy < gridHeight; ++cy) {
+        for (int cx = 0; cx < gridWidth; ++cx) {
+            if (kind[static_cast<size_t>(cy) * gridWidth + cx] != Stroke) {
+                continue;
+            }
+            bool quietNeighbour = false;
+            for (int ny = std::max(0, cy - 1); ny <= std::min(gridHeight - 1, cy + 1) && !quietNeighbour; ++ny) {
+                for (int nx = std::max(0, cx - 1); nx <= std::min(gridWidth - 1, cx + 1); ++nx) {
+                    if (kind[static_cast<size_t>(ny) * gridWidth + nx] == Quiet) {
+                        quietNeighbour = true;
+                        break;
+                    }
+                }
+            }
+            evidence.textCells += quietNeighbour;
+        }
+    }
+    return evidence;
+}
+
+GrayImage ToGray(const uint8_t* rgb, int width, int height, size_t stride) {
+    GrayImage gray(width, height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = rgb + y * stride;
+        uint8_t* dst = gray.Row(y);
+        // Plain integer arithmetic on independent pixels, which compilers
+        // turn into SIMD code at -O2/-O3
+        for (int x = 0; x < width; ++x) {
+            uint32_t r = src[3 * x];
+            uint32_t g = src[3 * x + 1];
+            uint32_t b = src[3 * x + 2];
+            dst[x] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+    return gray;
+}
+
+uint8_t OtsuThreshold(const GrayImage& image) {
+    uint64_t histogram[256] = {};
+    for (uint8_t p : image.pixels) {
+        ++histogram[p];
+    }
+
+    double total = static_cast<double>(image.pixels.size());
+    double sumAll = 0;
+    for (int i = 0; i < 256; ++i) {
+        sumAll += i * static_cast<double>(histogram[i]);
+    }
+
+    double sumBelow = 0;
+    double countBelow = 0;
+    double bestVariance = -1;
+    int best = 127;
+    for (int t = 0; t < 256; ++t) {
+        countBelow += histogram[t];
+        if (countBelow == 0) {
+            continue;
+        }
+        double countAbove = total - countBelow;
+        if (countAbove == 0) {
+            break;
+        }
+        sumBelow += t * static_cast<double>(histogram[t]);
+        double meanBelow = sumBelow / countBelow;
+        double meanAbove = (sumAll - sumBelow) / countAbove;
+        double variance = countBelow * countAbove * (meanBelow - meanAbove) * (meanBelow - meanAbove);
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            best = t;
+        }
+    }
+    return static_cast<uint8_t>(best);
+}
+
+void BinarizeOtsu(GrayImage& image) {
+    uint8_t threshold = OtsuThreshold(image);
+    for (uint8_t& p : image.pixels) {
+        p = p <= threshold ? 0 : 255;
+    }
+}
+
+void BinarizeSauvola(GrayImage& image, int window, double k) {
+    const int w = image.width;
+    const int h = image.height;
+    const int r = std::max(window / 2, 1);
+    const double R = 128.0;  // Dynamic range of the standard deviation
+
+    // Sums over the rows [y - r, y + r] for each column, slid down the image,
+    // so memory stays proportional to the width
+    std::vector<uint32_t> colSum(w, 0);
+    std::vector<uint64_t> colSq(w, 0);
+    auto addRow = [&](int y, int sign) {
+        const uint8_t* row = image.Row(y);
+        for (int x = 0; x < w; ++x) {
+            uint32_t p = row[x];
+            colSum[x] += sign * p;
+            colSq[x] += sign * static_cast<int64_t>(p * p);
+        }
+    };
+    for (int y = 0; y <= std::min(r, h - 1); ++y) {
+        addRow(y, 1);
+    }
+
+    std::vector<uint8_t> out(image.pixels.size());
+    for (int y = 0; y < h; ++y) {
+        if (y > 0) {
+            if (y + r < h) {
+                addRow(y + r, 1);
+            }
+            if (y - r - 1 >= 0) {
+                addRow(y - r - 1, -1);
+            }
+        }
+        const int rows = std::min(h - 1, y + r) - std::max(0, y - r) + 1;
+
+        uint64_t sum = 0;
+        uint64_t sq = 0;
+        for (int x = 0; x <= std::min(r, w - 1); ++x) {
+            sum += colSum[x];
+            sq += colSq[x];
+        }
+
+        const uint8_t* src = image.Row(y);
+        uint8_t* dst = out.data() + static_cast<size_t>(y) * w;
+        for (int x = 0; x < w; ++x) {
+            if (x > 0) {
+                if (x + r < w) {
+                    sum += colSum[x + r];
+                    sq += colSq[x + r];
+                }
+                if (x - r - 1 >= 0) {
+                    sum -= colSum[x - r - 1];
+                    sq -= colSq[x - r - 1];
+                }
+            }
+            const int cols = std::min(w - 1, x + r) - std::max(0, x - r) + 1;
+            const double n = static_cast<double>(rows) * cols;
+            const double mean = sum / n;
+            const double variance = std::max(0.0, sq / n - mean * mean);
+            const double threshold = mean * (1.0 + k * (std::sqrt(variance) / R - 1.0));
+            dst[x] = src[x] <= threshold ? 0 : 255;
+        }
+    }
+    image.pixels.swap(out);
+}
+
+GrayImage Resample(const GrayImage& image, int newWidth, int newHeight) {
+    if (newWidth == image.width && newHeight == image.height) {
+        return image;
+    }
+    Taps horizontal = BuildTaps(image.width, newWidth);
+    Taps vertical = BuildTaps(image.height, newHeight);
+
+    // Horizontal pass into floats, then vertical pass with rounding
+    std::vector<float> temp(static_cast<size_t>(newWidth) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t* src = image.Row(y);
+        float* dst = temp.data() + static_cast<size_t>(y) * newWidth;
+        for (int x = 0; x < newWidth; ++x) {
+            float value = 0;
+            for (size_t t = horizontal.start[x]; t < horizontal.start[x + 1]; ++t) {
+                value += src[horizontal.index[t]] * horizontal.weight[t];
+            }
+            dst[x] = value;
+        }
+    }
+
+    GrayImage result(newWidth, newHeight);
+    std::vector<float> row(newWidth);
+    for (int y = 0; y < newHeight; ++y) {
+        std::fill(row.begin(), row.end(), 0.0f);
+        for (size_t t = vertical.start[y]; t < vertical.start[y + 1]; ++t) {
+            const float* src = temp.data() + static_cast<size_t>(vertical.index[t]) * newWidth;
+            const float weight = vertical.weight[t];
+            for (int x = 0; x < newWidth; ++x) {
+                row[x] += src[x] * weight;
+            }
+        }
+        uint8_t* dst = result.Row(y);
+        for (int x = 0; x < newWidth; ++x) {
+            dst[x] = static_cast<uint8_t>(std::clamp(row[x] + 0.5f, 0.0f, 255.0f));
+        }
+    }
+    return result;
+}
+
+int EstimateTextHeight(const GrayImage& binary) {
+    std::vector<int> ink = RowInk(binary);
+    const int minInk = std::max(1, static_cast<int>(binary.width * MIN_ROW_INK));
+
+    std::vector<int> lines;
+    int run = 0;
+    for (int y = 0; y <= binary.height; ++y) {
+        if (y < binary.height && ink[y] >= minInk) {
+            ++run;
+            continue;
+        }
+        if (run >= MIN_LINE_HEIGHT) {
+            lines.push_back(run);
+        }
+        run = 0;
+    }
+    if (lines.empty()) {
+        return 0;
+    }
+
+    std::nth_element(lines.begin(), lines.begin() + lines.size() / 2, lines.end());
+    return lines[lines.size() / 2];
+}
+
+double EstimateSkew(const GrayImage& binary, double maxDegrees, double stepDegrees) {
+    // Collect ink coordinates, subsampled on large images
+    size_t inkCount = 0;
+    for (uint8_t p : binary.pixels) {
+        inkCount += p == 0;
+    }
+    if (inkCount == 0) {
+        return 0.0;
+    }
+    const size_t every = std::max<size_t>(1, inkCount / MAX_SKEW_POINTS);
+
+    std::vector<int> xs;
+    std::vector<int> ys;
+    size_t seen = 0;
+    for (int y = 0; y < binary.height; ++y) {
+        const uint8_t* row = binary.Row(y);
+        for (int x = 0; x < binary.width; ++x) {
+            if (row[x] == 0 && seen++ % every == 0) {
+                xs.push_back(x);
+                ys.push_back(y);
+            }
+        }
+    }
+
+    // Text lines are sharpest in the row profile when the projection
+    // direction matches their slope
+    const int margin = static_cast<int>(std::ceil(binary.width * std::tan(maxDegrees * PI / 180.0))) + 1;
+    std::vector<uint32_t> bins(binary.height + 2 * margin);
+    double bestScore = -1;
+    double bestAngle = 0.0;
+    for (double angle = -maxDegrees; angle <= maxDegrees + 1e-9; angle += stepDegrees) {
+        const double slope = std::tan(angle * PI / 180.0);
+        std::fill(bins.begin(), bins.end(), 0);
+        for (size_t i = 0; i < xs.size(); ++i) {
+            int bin = static_cast<int>(std::lround(ys[i] + xs[i] * slope)) + margin;
+            if (bin >= 0 && bin < static_cast<int>(bins.size())) {
+                ++bins[bin];
+            }
+        }
+        double score = 0;
+        for (uint32_t count : bins) {
+            score += static_cast<double>(count) * count;
+        }
+        // Prefer the smaller angle on ties so clean images stay untouched
+        if (score > bestScore || (score == bestScore && std::abs(angle) < std::abs(bestAngle))) {
+            bestScore = score;
+            bestAngle = angle;
+        }
+    }
+    return bestAngle;
+}
+
+GrayImage Rotate(const GrayImage& image, double degrees) {
+    GrayImage result(image.width, image.height, 255);
+    const double radians = degrees * PI / 180.0;
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    const double cx = (image.width - 1) / 2.0;
+    const double cy = (image.height - 1) / 2.0;
+
+    for (int y = 0; y < image.height; ++y) {
+        uint8_t* dst = result.Row(y);
+        const double dy = y - cy;
+        for (int x = 0; x < image.width; ++x) {
+            // Inverse mapping; positive angles turn the content counter-clockwise
+            const double dx = x - cx;
+            const double sx = cx + dx * c - dy * s;
+            const double sy = cy + dx * s + dy * c;
+            const int x0 = static_cast<int>(std::floor(sx));
+            const int y0 = static_cast<int>(std::floor(sy));
+            if (x0 < 0 || y0 < 0 || x0 + 1 >= image.width || y0 + 1 >= image.height) {
+                continue;
+            }
+            const double fx = sx - x0;
+            const double fy = sy - y0;
+            const uint8_t* r0 = image.Row(y0) + x0;
+            const uint8_t* r1 = image.Row(y0 + 1) + x0;
+            const double top = r0[0] + (r0[1] - r0[0]) * fx;
+            const double bottom = r1[0] + (r1[1] - r1[0]) * fx;
+            dst[x] = static_cast<uint8_t>(top + (bottom - top) * fy + 0.5);
+        }
+    }
+    return result;
+}
+
+std::vector<Strip> PlanStrips(const GrayImage& image, int stripHeight, int overlap,
+                              int firstStripHeight) {
+    std::vector<Strip> strips;
+    if (!image.IsOk()) {
+        return strips;
+    }
+    stripHeight = std::max(stripHeight, 2 * MIN_LINE_HEIGHT);
+    firstStripHeight = firstStripHeight > 0 ? std::max(firstStripHeight, 2 * MIN_LINE_HEIGHT) : stripHeight;
+    overlap = std::clamp(overlap, 0, std::min(stripHeight, firstStripHeight) / 2);
+
+    // One strip is enough unless splitting buys real parallelism
+    if (image.height <= firstStripHeight + firstStripHeight / 4) {
+        strips.push_back(Strip{0, image.height, false});
+        return strips;
+    }
+
+    GrayImage binary = image;
+    BinarizeOtsu(binary);
+    std::vector<int> ink = RowInk(binary);
+    const int minInk = std::max(1, static_cast<int>(image.width * MIN_ROW_INK));
+
+    int top = 0;
+    bool overlapsPrevious = false;
+    while (top < image.height) {
+        int height = strips.empty() ? firstStripHeight : stripHeight;
+        int end = top + height;
+        if (end + height / 4 >= image.height) {
+            strips.push_back(Strip{top, image.height, overlapsPrevious});
+            break;
+        }
+
+        // Cut in the middle of the blank gap closest to the preferred end,
+        // looking back as far as half a strip
+        int cut = -1;
+        for (int y = end; y > top + height / 2; --y) {
+            if (ink[y] < minInk) {
+                int gapTop = y;
+                while (gapTop > top && ink[gapTop - 1] < minInk) {
+                    --gapTop;
+                }
+                cut = (gapTop + y + 1) / 2;
+                break;
+            }
+        }
+
+        if (cut > top) {
+            strips.push_back(Strip{top, cut, overlapsPrevious});
+            top = cut;
+            overlapsPrevious = false;
+        } else {
+            strips.push_back(Strip{top, end, overlapsPrevious});
+            top = end - overlap;
+            overlapsPrevious = true;
+        }
+    }
+    return strips;
+}
+
+GrayImage Prepare(const uint8_t* rgb, int width, int height, size_t stride,
+                  const Options& options, Report* report) {
+    Report local;
+    Report& info = report ? *report : local;
+    info = Report();
+
+    GrayImage gray = ToGray(rgb, width, height, stride);
+    if (!gray.IsOk()) {
+        return gray;
+    }
+
+    // Dark mode screenshots: make the text dark on light, as Tesseract expects
+    uint8_t threshold = OtsuThreshold(gray);
+    size_t dark = 0;
+    for (uint8_t p : gray.pixels) {
+        dark += p <= threshold;
+    }
+    if (dark * 2 > gray.pixels.size()) {
+        for (uint8_t& p : gray.pixels) {
+            p = 255 - p;
+        }
+        info.inverted = true;
+    }
+
+    // Bring text lines to the height Tesseract reads best
+    double scale = 1.0;
+    if (options.normalizeScale) {
+        GrayImage binary = gray;
+        BinarizeOtsu(binary);
+        info.textHeight = EstimateTextHeight(binary);
+        if (info.textHeight > 0) {
+            scale = std::clamp(static_cast<double>(options.targetTextHeight) / info.textHeight,
+                               options.minScale, options.maxScale);
+        }
+    }
+    const int capWidth = options.tiled ? options.maxTiledWidth : options.maxDimension;
+    const int capHeight = options.tiled ? options.maxTiledHeight : options.maxDimension;
+    if (capWidth > 0 && capHeight > 0 && (width * scale > capWidth || height * scale > capHeight)) {
+        scale = std::min(static_cast<double>(capWidth) / width, static_cast<double>(capHeight) / height);
+        info.limitedByMaxDimension = true;
+    }
+    // Small adjustments only blur the glyphs
+    if (std::abs(scale - 1.0) >= 0.1 || info.limitedByMaxDimension) {
+        int newWidth = std::max(1, static_cast<int>(std::lround(width * scale)));
+        int newHeight = std::max(1, static_cast<int>(std::lround(height * scale)));
+        gray = Resample(gray, newWidth, newHeight);
+        info.scale = scale;
+    }
+
+    if (options.deskew) {
+        GrayImage binary = gray;
+        BinarizeOtsu(binary);
+        double skew = EstimateSkew(binary);
+        if (std::abs(skew) >= 0.2) {
+            gray = Rotate(gray, -skew);
+            info.skewDegrees = skew;
+        }
+    }
+
+    switch (options.binarization) {
+        case Binarization::Otsu:
+            BinarizeOtsu(gray);
+            break;
+        case Binarization::Sauvola:
+            BinarizeSauvola(gray, options.sauvolaWindow, options.sauvolaK);
+            break;
+        case Binarization::None:
+            break;
+    }
+    return gray;
+}
+
+}
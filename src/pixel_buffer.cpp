@@ -0,0 +1,93 @@
+#include "../include/pixel_buffer.h"
+#include <wx/mstream.h>
+#include <wx/rawbmp.h>
+
+// The pixels live in a wxImage that nothing else references. It is never
+// copied after construction, so its (non-atomic) reference count is not
+// touched by the threads that read it.
+struct PixelBuffer::Storage {
+    wxImage image;
+};
+
+PixelBuffer::PixelBuffer(std::shared_ptr<const Storage> storage)
+{
+    const wxImage& image = storage->image;
+    if (!image.IsOk()) {
+        return;
+    }
+    m_pixels = image.GetData();
+    m_alpha = image.HasAlpha() ? image.GetAlpha() : nullptr;
+    m_width = image.GetWidth();
+    m_height = image.GetHeight();
+    m_storage = std::move(storage);
+}
+
+PixelBuffer::PixelBuffer(wxImage image)
+{
+    auto storage = std::make_shared<Storage>();
+    storage->image = image;
+    // Drop our own reference first, so the image is only copied if the
+    // caller still holds one
+    image = wxImage();
+    storage->image.UnShare();
+    *this = PixelBuffer(std::shared_ptr<const Storage>(std::move(storage)));
+}
+
+PixelBuffer PixelBuffer::FromBitmap(const wxBitmap& bitmap)
+{
+    if (!bitmap.IsOk()) {
+        return PixelBuffer();
+    }
+    return FromBitmap(bitmap, wxRect(0, 0, bitmap.GetWidth(), bitmap.GetHeight()));
+}
+
+PixelBuffer PixelBuffer::FromBitmap(const wxBitmap& bitmap, const wxRect& area)
+{
+    if (!bitmap.IsOk()) {
+        return PixelBuffer();
+    }
+    wxRect bounds = area.Intersect(wxRect(0, 0, bitmap.GetWidth(), bitmap.GetHeight()));
+    if (bounds.IsEmpty()) {
+        return PixelBuffer();
+    }
+
+    // Alpha bitmaps are premultiplied in native form on some platforms;
+    // wxImage conversion undoes that, so leave them to it
+    if (!bitmap.HasAlpha()) {
+        // Raw access needs a non-const bitmap but only reads it here
+        wxNativePixelData source(const_cast<wxBitmap&>(bitmap), bounds);
+        if (source) {
+            auto storage = std::make_shared<Storage>();
+            if (!storage->image.Create(bounds.width, bounds.height, false)) {
+                return PixelBuffer();
+            }
+            unsigned char* dst = storage->image.GetData();
+            wxNativePixelData::Iterator row(source);
+            for (int y = 0; y < bounds.height; ++y) {
+                wxNativePixelData::Iterator pixel = row;
+                for (int x = 0; x < bounds.width; ++x, ++pixel) {
+                    *dst++ = pixel.Red();
+                    *dst++ = pixel.Green();
+                    *dst++ = pixel.Blue();
+                }
+                row.OffsetY(source, 1);
+            }
+            return PixelBuffer(std::shared_ptr<const Storage>(std::move(storage)));
+        }
+    }
+
+    if (bounds == wxRect(0, 0, bitmap.GetWidth(), bitmap.GetHeight())) {
+        return PixelBuffer(bitmap.ConvertToImage());
+    }
+    return PixelBuffer(bitmap.GetSubBitmap(bounds).ConvertToImage());
+}
+
+PixelBuffer PixelBuffer::Decode(const void* bytes, size_t size, wxBitmapType type)
+{
+    wxMemoryInputStream stream(bytes, size);
+    auto storage = std::make_shared<Storage>();
+    if (!storage->image.LoadFile(stream, type)) {
+        return PixelBuffer();
+    }
+    return PixelBuffer(std::shared_ptr<const Storage>(std::move(storage)));
+}
@@ -168,7 +168,7 @@ void ScreenshotFrame::ProcessSelection() {
     }
     
     std::cout << "Screenshot bitmap size: " << m_screenshot.GetWidth() << "x" << m_screenshot.GetHeight() << std::endl;
-    std::cout << "Creating bitmap from selected region" << std::endl;
+    std::cout << "Reading pixels of selected region" << std::endl;
     
     // Adjust selection rectangle to be relative to the virtual screen coordinates
     wxRect adjustedRect = m_selectionRect;
@@ -220,32 +220,19 @@ void ScreenshotFrame::ProcessSelection() {
     std::cout << "Final selection rectangle: " << adjustedRect.x << "," << adjustedRect.y 
               << " " << adjustedRect.width << "x" << adjustedRect.height << std::endl;
     
-    // Now create the bitmap from the correctly adjusted coordinates
-    wxBitmap selectedBitmap;
-    try {
-        selectedBitmap = m_screenshot.GetSubBitmap(adjustedRect);
-        std::cout << "Bitmap created successfully" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Exception creating sub-bitmap: " << e.what() << std::endl;
-        Close(true);
-        return;
-    } catch (...) {
-        std::cerr << "Unknown exception creating sub-bitmap" << std::endl;
-        Close(true);
-        return;
-    }
-    
-    // Check if the created bitmap is valid
-    if (!selectedBitmap.IsOk()) {
-        std::cerr << "Selected bitmap is invalid after creation!" << std::endl;
+    // Read the selected pixels straight out of the capture, without an
+    // intermediate sub-bitmap
+    PixelBuffer selection = PixelBuffer::FromBitmap(m_screenshot, adjustedRect);
+    if (!selection.IsOk()) {
+        std::cerr << "Failed to read the selected area of the screenshot" << std::endl;
         Close(true);
         return;
     }
     
-    // Call the callback with the selected bitmap
+    // Call the callback with the selected pixels
     if (m_callback) {
-        std::cout << "Calling callback with bitmap" << std::endl;
-        m_callback(selectedBitmap);
+        std::cout << "Calling callback with selection" << std::endl;
+        m_callback(selection);
     }
     
     // Close the screenshot frame
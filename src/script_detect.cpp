@@ -0,0 +1,101 @@
+#include "../include/script_detect.h"
+#include <algorithm>
+#include <vector>
+
+namespace ScriptDetect {
+
+// Frequent characters whose forms differ between the scripts. The two lists
+// are paired position by position. Characters that are also used, with
+// another meaning, in the other script (后, 里, 发, 干, 面, ...) are left out.
+static const char SIMPLIFIED_ONLY[] =
+    "这个们来说时会为国对学经过还没动点现么开长问间见样当进种实从关机电话东车书"
+    "无业头与两体听边让请认应题爱气马门钱写买卖读语给觉华报将岁战员张产务结级组"
+    "许论设计识议记调变历区处众总条统帮热难视网页线号图单该贵钟药医错终选择节转"
+    "运乐农观欢确离亲虽办场际传兴质术导称讲飞鸟鱼龙风军红绿蓝银铁货费资贸价险输"
+    "剧艺简汉讯词译释";
+
+static const char TRADITIONAL_ONLY[] =
+    "這個們來說時會為國對學經過還沒動點現麼開長問間見樣當進種實從關機電話東車書"
+    "無業頭與兩體聽邊讓請認應題愛氣馬門錢寫買賣讀語給覺華報將歲戰員張產務結級組"
+    "許論設計識議記調變歷區處眾總條統幫熱難視網頁線號圖單該貴鐘藥醫錯終選擇節轉"
+    "運樂農觀歡確離親雖辦場際傳興質術導稱講飛鳥魚龍風軍紅綠藍銀鐵貨費資貿價險輸"
+    "劇藝簡漢訊詞譯釋";
+
+// Decode UTF-8 into code points; malformed bytes are skipped
+static std::vector<char32_t> DecodeUtf8(const std::string& text) {
+    std::vector<char32_t> codePoints;
+    codePoints.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            ++i;
+            continue;
+        }
+        char32_t codePoint = length == 1 ? lead : lead & (0x7F >> length);
+        bool valid = true;
+        for (size_t k = 1; k < length; ++k) {
+            unsigned char next = static_cast<unsigned char>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+        if (valid) {
+            codePoints.push_back(codePoint);
+            i += length;
+        } else {
+            ++i;
+        }
+    }
+    return codePoints;
+}
+
+static std::vector<char32_t> SortedSet(const char* utf8) {
+    std::vector<char32_t> set = DecodeUtf8(utf8);
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+Result Classify(const std::string& utf8, size_t minEvidence, double minConfidence) {
+    static const std::vector<char32_t> simplifiedOnly = SortedSet(SIMPLIFIED_ONLY);
+    static const std::vector<char32_t> traditionalOnly = SortedSet(TRADITIONAL_ONLY);
+
+    Result result;
+    for (char32_t c : DecodeUtf8(utf8)) {
+        // Both lists lie inside the CJK Unified Ideographs block
+        if (c < 0x4E00 || c > 0x9FFF) {
+            continue;
+        }
+        if (std::binary_search(simplifiedOnly.begin(), simplifiedOnly.end(), c)) {
+            ++result.simplified;
+        } else if (std::binary_search(traditionalOnly.begin(), traditionalOnly.end(), c)) {
+            ++result.traditional;
+        }
+    }
+
+    size_t evidence = result.simplified + result.traditional;
+    if (evidence == 0) {
+        return result;
+    }
+    result.confidence = static_cast<double>(std::max(result.simplified, result.traditional)) / evidence;
+    if (evidence >= minEvidence && result.confidence >= minConfidence) {
+        result.script = result.simplified > result.traditional ? Script::Simplified : Script::Traditional;
+    }
+    return result;
+}
+
+const char* ToString(Script script) {
+    switch (script) {
+        case Script::Simplified:
+            return "simplified";
+        case Script::Traditional:
+            return "traditional";
+        default:
+            return "unknown";
+    }
+}
+
+}
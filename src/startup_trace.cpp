@@ -0,0 +1,32 @@
+#include "../include/startup_trace.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace StartupTrace {
+
+namespace {
+    std::mutex s_mutex;
+    bool s_started = false;
+    std::chrono::steady_clock::time_point s_start;
+    std::chrono::steady_clock::time_point s_last;
+}
+
+void Mark(const char* phase)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (!s_started) {
+        s_started = true;
+        s_start = now;
+        s_last = now;
+    }
+
+    using ms = std::chrono::duration<double, std::milli>;
+    std::printf("[startup] %8.1f ms (+%7.1f ms) %s\n",
+                ms(now - s_start).count(), ms(now - s_last).count(), phase);
+    std::fflush(stdout);
+    s_last = now;
+}
+
+}
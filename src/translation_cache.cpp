@@ -0,0 +1,355 @@
+#include "../include/translation_cache.h"
+#include "../include/image_hash.h"
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/stdpaths.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+// File header: magic and format version
+static const char CACHE_MAGIC[4] = {'H', 'S', 'T', 'C'};
+static const uint32_t CACHE_VERSION = 1;
+static const uint64_t HEADER_SIZE = sizeof(CACHE_MAGIC) + sizeof(CACHE_VERSION);
+
+// Record: key length, value length, checksum, key, value
+static const uint64_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+// Don't bother compacting logs smaller than this
+static const uint64_t MIN_COMPACT_SIZE = 1024 * 1024;
+
+static bool IsAsciiSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+static uint64_t RecordChecksum(const std::string& key, const std::string& value) {
+    return HashBytes(value.data(), value.size(), HashBytes(key.data(), key.size()));
+}
+
+TranslationCache::TranslationCache(const wxString& path, size_t maxMemoryBytes)
+    : m_path(path.utf8_str()),
+      m_maxMemoryBytes(maxMemoryBytes),
+      m_fileSize(0),
+      m_liveBytes(0),
+      m_lruBytes(0)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Load();
+}
+
+TranslationCache::~TranslationCache()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+wxString TranslationCache::DefaultPath()
+{
+    wxFileName path(wxStandardPaths::Get().GetUserDataDir(), "translation_cache.log");
+    path.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    return path.GetFullPath();
+}
+
+std::string TranslationCache::CanonicalKey(const wxString& text)
+{
+    std::string key(text.utf8_str());
+
+    // Trim ASCII whitespace and U+3000 (ideographic space, "\xE3\x80\x80")
+    size_t begin = 0;
+    size_t end = key.size();
+    while (begin < end) {
+        if (IsAsciiSpace(key[begin])) {
+            ++begin;
+        } else if (end - begin >= 3 && key.compare(begin, 3, "\xE3\x80\x80") == 0) {
+            begin += 3;
+        } else {
+            break;
+        }
+    }
+    while (end > begin) {
+        if (IsAsciiSpace(key[end - 1])) {
+            --end;
+        } else if (end - begin >= 3 && key.compare(end - 3, 3, "\xE3\x80\x80") == 0) {
+            end -= 3;
+        } else {
+            break;
+        }
+    }
+    return key.substr(begin, end - begin);
+}
+
+void TranslationCache::Load()
+{
+    // Create the file with a header if it doesn't exist yet
+    std::ifstream probe(m_path, std::ios::binary);
+    bool exists = probe.good();
+    probe.close();
+    if (!exists) {
+        std::ofstream create(m_path, std::ios::binary);
+        create.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        create.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+    }
+
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open()) {
+        wxLogWarning("Could not open translation cache: %s", wxString::FromUTF8(m_path));
+        return;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    m_file.read(magic, sizeof(magic));
+    m_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!m_file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION) {
+        // Unknown format: start over rather than guess
+        m_file.close();
+        std::ofstream reset(m_path, std::ios::binary | std::ios::trunc);
+        reset.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        reset.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+        reset.close();
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+        m_fileSize = HEADER_SIZE;
+        return;
+    }
+
+    m_file.seekg(0, std::ios::end);
+    uint64_t totalSize = static_cast<uint64_t>(m_file.tellg());
+    m_file.seekg(HEADER_SIZE);
+    
+    // Scan records; later records for a key supersede earlier ones
+    uint64_t offset = HEADER_SIZE;
+    std::string key;
+    std::string value;
+    while (true) {
+        uint32_t keyLength = 0;
+        uint32_t valueLength = 0;
+        uint64_t checksum = 0;
+        m_file.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
+        m_file.read(reinterpret_cast<char*>(&valueLength), sizeof(valueLength));
+        m_file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+        if (!m_file || offset + RECORD_HEADER_SIZE + keyLength + valueLength > totalSize) {
+            break;
+        }
+
+        key.resize(keyLength);
+        value.resize(valueLength);
+        m_file.read(&key[0], keyLength);
+        m_file.read(&value[0], valueLength);
+        if (!m_file || RecordChecksum(key, value) != checksum) {
+            wxLogDebug("Translation cache: dropping torn record at offset %llu",
+                       static_cast<unsigned long long>(offset));
+            break;
+        }
+
+        uint64_t recordSize = RECORD_HEADER_SIZE + keyLength + valueLength;
+        auto existing = m_index.find(key);
+        if (existing != m_index.end()) {
+            m_liveBytes -= RECORD_HEADER_SIZE + key.size() + existing->second.valueLength;
+        }
+        m_index[key] = IndexEntry{offset + RECORD_HEADER_SIZE + keyLength, valueLength};
+        m_liveBytes += recordSize;
+        offset += recordSize;
+    }
+    m_fileSize = offset;
+    m_file.clear();
+    
+    // Cut off a torn tail so new records follow the last good one
+    if (totalSize > m_fileSize) {
+        m_file.close();
+        std::error_code error;
+        std::filesystem::resize_file(m_path, m_fileSize, error);
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    wxLogDebug("Translation cache loaded: %zu entries, %llu bytes",
+               m_index.size(), static_cast<unsigned long long>(m_fileSize));
+
+    // Rewrite when most of the log is superseded records
+    if (m_fileSize > MIN_COMPACT_SIZE && m_fileSize > 2 * (m_liveBytes + HEADER_SIZE)) {
+        Compact();
+    }
+}
+
+void TranslationCache::Compact()
+{
+    std::string tempPath = m_path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return;
+    }
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+
+    std::unordered_map<std::string, IndexEntry> newIndex;
+    uint64_t offset = HEADER_SIZE;
+    std::string value;
+    for (const auto& entry : m_index) {
+        const std::string& key = entry.first;
+        value.resize(entry.second.valueLength);
+        m_file.seekg(entry.second.valueOffset);
+        m_file.read(&value[0], value.size());
+        if (!m_file) {
+            m_file.clear();
+            continue;
+        }
+
+        uint32_t keyLength = static_cast<uint32_t>(key.size());
+        uint32_t valueLength = static_cast<uint32_t>(value.size());
+        uint64_t checksum = RecordChecksum(key, value);
+        out.write(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+        out.write(reinterpret_cast<const char*>(&valueLength), sizeof(valueLength));
+        out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        out.write(key.data(), key.size());
+        out.write(value.data(), value.size());
+
+        newIndex[key] = IndexEntry{offset + RECORD_HEADER_SIZE + keyLength, valueLength};
+        offset += RECORD_HEADER_SIZE + keyLength + valueLength;
+    }
+    out.close();
+    if (!out) {
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    m_file.close();
+    if (std::rename(tempPath.c_str(), m_path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+        return;
+    }
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+
+    wxLogDebug("Translation cache compacted from %llu to %llu bytes",
+               static_cast<unsigned long long>(m_fileSize), static_cast<unsigned long long>(offset));
+    m_index.swap(newIndex);
+    m_fileSize = offset;
+    m_liveBytes = offset - HEADER_SIZE;
+}
+
+bool TranslationCache::Append(const std::string& key, const std::string& value)
+{
+    uint32_t keyLength = static_cast<uint32_t>(key.size());
+    uint32_t valueLength = static_cast<uint32_t>(value.size());
+    uint64_t checksum = RecordChecksum(key, value);
+
+    m_file.seekp(m_fileSize);
+    m_file.write(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+    m_file.write(reinterpret_cast<const char*>(&valueLength), sizeof(valueLength));
+    m_file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    m_file.write(key.data(), key.size());
+    m_file.write(value.data(), value.size());
+    m_file.flush();
+    if (!m_file) {
+        m_file.clear();
+        return false;
+    }
+
+    uint64_t recordSize = RECORD_HEADER_SIZE + keyLength + valueLength;
+    auto existing = m_index.find(key);
+    if (existing != m_index.end()) {
+        m_liveBytes -= RECORD_HEADER_SIZE + key.size() + existing->second.valueLength;
+    }
+    m_index[key] = IndexEntry{m_fileSize + RECORD_HEADER_SIZE + keyLength, valueLength};
+    m_liveBytes += recordSize;
+    m_fileSize += recordSize;
+    return true;
+}
+
+void TranslationCache::Remember(const std::string& key, const nlohmann::json& response, size_t bytes)
+{
+    auto existing = m_lruIndex.find(key);
+    if (existing != m_lruIndex.end()) {
+        m_lruBytes -= existing->second->bytes;
+        m_lru.erase(existing->second);
+        m_lruIndex.erase(existing);
+    }
+
+    m_lru.push_front(LruEntry{key, response, bytes});
+    m_lruIndex[key] = m_lru.begin();
+    m_lruBytes += bytes;
+
+    // Evict least recently used, but always keep the newest entry
+    while (m_lruBytes > m_maxMemoryBytes && m_lru.size() > 1) {
+        m_lruBytes -= m_lru.back().bytes;
+        m_lruIndex.erase(m_lru.back().key);
+        m_lru.pop_back();
+    }
+}
+
+bool TranslationCache::Lookup(const wxString& text, nlohmann::json& response)
+{
+    std::string key = CanonicalKey(text);
+    if (key.empty()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto cached = m_lruIndex.find(key);
+    if (cached != m_lruIndex.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, cached->second);
+        response = cached->second->response;
+        return true;
+    }
+
+    auto entry = m_index.find(key);
+    if (entry == m_index.end() || !m_file.is_open()) {
+        return false;
+    }
+
+    std::string value(entry->second.valueLength, '\0');
+    m_file.seekg(entry->second.valueOffset);
+    m_file.read(&value[0], value.size());
+    if (!m_file) {
+        m_file.clear();
+        return false;
+    }
+
+    try {
+        response = nlohmann::json::parse(value);
+    } catch (const std::exception& e) {
+        wxLogDebug("Translation cache: unreadable entry: %s", e.what());
+        return false;
+    }
+
+    Remember(key, response, value.size());
+    return true;
+}
+
+bool TranslationCache::Store(const wxString& text, const nlohmann::json& response)
+{
+    std::string key = CanonicalKey(text);
+    if (key.empty()) {
+        return false;
+    }
+    std::string value = response.dump();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_file.is_open()) {
+        // Skip the write when nothing changed (e.g. after a revalidation)
+        auto entry = m_index.find(key);
+        bool unchanged = false;
+        if (entry != m_index.end() && entry->second.valueLength == value.size()) {
+            std::string stored(value.size(), '\0');
+            m_file.seekg(entry->second.valueOffset);
+            m_file.read(&stored[0], stored.size());
+            unchanged = m_file && stored == value;
+            m_file.clear();
+        }
+        if (!unchanged && !Append(key, value)) {
+            wxLogDebug("Translation cache: failed to write entry");
+        }
+    }
+
+    Remember(key, response, value.size());
+    return true;
+}
+
+size_t TranslationCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
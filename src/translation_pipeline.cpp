@@ -0,0 +1,245 @@
+#include "../include/translation_pipeline.h"
+#include "../include/ocr.h"
+#include "../include/ocr_preprocess.h"
+#include <wx/log.h>
+
+TranslationPipeline::TranslationPipeline(wxEvtHandler* owner, Translator translator,
+                                         ResultCallback onResult, size_t maxTextLength,
+                                         TranslationCache* cache, OcrCache* ocrCache)
+    : m_owner(owner),
+      m_translator(translator),
+      m_onResult(onResult),
+      m_maxTextLength(maxTextLength),
+      m_cache(cache),
+      m_ocrCache(ocrCache),
+      m_minTextCells(4),
+      m_rejectedImages(0),
+      m_generation(0),
+      m_stopping(false)
+{
+    m_worker = std::thread(&TranslationPipeline::Run, this);
+}
+
+TranslationPipeline::~TranslationPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        if (m_running) {
+            m_running->store(true);
+        }
+        m_pending.reset();
+    }
+    m_jobAvailable.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void TranslationPipeline::SubmitText(const wxString& text, bool revalidate)
+{
+    Job job;
+    job.text = text;
+    job.revalidate = revalidate;
+    Submit(std::move(job));
+}
+
+void TranslationPipeline::SubmitImage(const PixelBuffer& image)
+{
+    Job job;
+    job.image = image;
+    Submit(std::move(job));
+}
+
+void TranslationPipeline::Submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Abort whatever is in flight; an unstarted job is simply replaced
+        if (m_running) {
+            m_running->store(true);
+        }
+
+        job.generation = ++m_generation;
+        job.cancelled = std::make_shared<std::atomic<bool>>(false);
+        m_pending = std::move(job);
+    }
+    m_jobAvailable.notify_one();
+}
+
+void TranslationPipeline::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Bumping the generation also discards results already on their way
+    ++m_generation;
+    if (m_running) {
+        m_running->store(true);
+    }
+    m_pending.reset();
+}
+
+bool TranslationPipeline::IsBusy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.has_value() || m_running != nullptr;
+}
+
+void TranslationPipeline::SetTextThreshold(size_t minTextCells)
+{
+    m_minTextCells = minTextCells;
+}
+
+size_t TranslationPipeline::GetTextThreshold() const
+{
+    return m_minTextCells.load();
+}
+
+size_t TranslationPipeline::GetRejectedImages() const
+{
+    return m_rejectedImages.load();
+}
+
+void TranslationPipeline::Run()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() { return m_stopping || m_pending.has_value(); });
+            if (m_stopping) {
+                return;
+            }
+
+            job = std::move(*m_pending);
+            m_pending.reset();
+            m_running = job.cancelled;
+        }
+
+        try {
+            Process(job);
+        } catch (const std::exception& e) {
+            TranslationResult result;
+            result.error = wxString::Format("Translation failed: %s", e.what());
+            Deliver(job, result);
+        } catch (...) {
+            TranslationResult result;
+            result.error = "Translation failed: unknown error";
+            Deliver(job, result);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running.reset();
+    }
+}
+
+void TranslationPipeline::Process(Job& job)
+{
+    TranslationResult result;
+    result.text = job.text;
+    result.revalidation = job.revalidate;
+
+    // OCR stage; an image seen before skips recognition
+    if (job.image.IsOk()) {
+        if (!LooksLikeText(job.image)) {
+            result.status = TranslationResult::Status::NotText;
+            Deliver(job, result);
+            return;
+        }
+
+        OcrCache::Fingerprint fingerprint;
+        bool cached = false;
+        if (m_ocrCache) {
+            fingerprint = OcrCache::ComputeFingerprint(job.image);
+            cached = m_ocrCache->Lookup(fingerprint, result.text);
+        }
+
+        if (!cached) {
+            if (!OcrEngine::EnsureInitialized("chi_sim+chi_tra")) {
+                result.error = "Failed to initialize OCR engine for Chinese";
+                Deliver(job, result);
+                return;
+            }
+            result.text = OcrEngine::ExtractTextFromImage(job.image, job.cancelled.get());
+        }
+        job.image = PixelBuffer();  // Release the pixels before the slow network stage
+
+        if (job.cancelled->load()) {
+            return;
+        }
+
+        // Errors are reported as text; only keep real results
+        if (m_ocrCache && !cached && !result.text.StartsWith("OCR Error") &&
+            !result.text.StartsWith("Unknown OCR error")) {
+            m_ocrCache->Store(fingerprint, result.text);
+        }
+
+        if (result.text.IsEmpty()) {
+            result.status = TranslationResult::Status::NoText;
+            Deliver(job, result);
+            return;
+        }
+    }
+
+    if (result.text.Length() > m_maxTextLength) {
+        result.status = TranslationResult::Status::TooMuchText;
+        Deliver(job, result);
+        return;
+    }
+
+    // Text seen before needs no request
+    if (m_cache && !job.revalidate && m_cache->Lookup(result.text, result.response)) {
+        result.status = TranslationResult::Status::Translated;
+        result.fromCache = true;
+        Deliver(job, result);
+        return;
+    }
+
+    // Network stage
+    result.response = m_translator(result.text, *job.cancelled);
+    if (job.cancelled->load()) {
+        wxLogDebug("TranslationPipeline: request superseded, dropping result");
+        return;
+    }
+
+    // Only cache real translations, not error responses
+    if (m_cache && result.response.contains("translation")) {
+        m_cache->Store(result.text, result.response);
+    }
+
+    result.status = TranslationResult::Status::Translated;
+    Deliver(job, result);
+}
+
+void TranslationPipeline::Deliver(const Job& job, TranslationResult result)
+{
+    uint64_t generation = job.generation;
+    m_owner->CallAfter([this, generation, result]() {
+        // A newer job was submitted while this result was in transit
+        if (generation != m_generation.load()) {
+            return;
+        }
+        m_onResult(result);
+    });
+}
+
+bool TranslationPipeline::LooksLikeText(const PixelBuffer& image)
+{
+    size_t minTextCells = m_minTextCells.load();
+    if (minTextCells == 0) {
+        return true;
+    }
+
+    OcrPreprocess::TextEvidence evidence = OcrPreprocess::MeasureTextEvidence(
+        image.GetData(), image.GetWidth(), image.GetHeight(), image.GetStride());
+    if (evidence.textCells >= minTextCells) {
+        return true;
+    }
+
+    ++m_rejectedImages;
+    wxLogDebug("TranslationPipeline: image has %zu of %zu cells like text, skipping OCR",
+               evidence.textCells, evidence.cells);
+    return false;
+}